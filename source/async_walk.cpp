@@ -0,0 +1,412 @@
+/* Built only with C++20 (CPLUSPLUS_20 in CMakeLists.txt). */
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include "async_walk.hpp"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+using boost::filesystem::path;
+using boost::filesystem::directory_entry;
+
+namespace
+{
+    typedef std::function<bool(directory_entry&)> source_type;
+    
+    template<typename iterator_type> source_type make_source(const iterator_type&);
+    void resume(const filesystem::async_options&, const std::coroutine_handle<>&);
+    
+    
+    /**
+     * @return A source yielding the entries of a copy of "i", starting with
+     * the one it is on.  Each call advances past the entry the last call
+     * gave, so all of the iterator's work happens inside the calls.
+     */
+    template<typename iterator_type>
+    inline source_type make_source(const iterator_type& i)
+    {
+        std::shared_ptr<iterator_type> it(new iterator_type(i));
+        std::shared_ptr<bool> first(new bool(true));
+        return [it, first](directory_entry& entry)
+        {
+            if(!*first && !it->end()) ++(*it);
+            *first = false;
+            if(it->end()) return false;
+            entry = **it;
+            return true;
+        };
+    }
+    
+    /**
+     * @brief Resumes a coroutine the way the options ask.
+     */
+    inline void resume(const filesystem::async_options& o, const std::coroutine_handle<>& h)
+    {
+        if(o.resume) o.resume(h);
+        else h.resume();
+    }
+    
+    
+}
+
+//io_pool member functions:
+namespace filesystem
+{
+    struct io_pool::queue
+    {
+        queue() : 
+                lock(), 
+                ready(), 
+                jobs(), 
+                stop(false)
+        {
+        }
+        
+        std::mutex lock;
+        std::condition_variable ready;
+        std::deque<std::function<void()> > jobs;
+        bool stop;
+    };
+    
+    /**
+     * @param count The number of threads.
+     */
+    io_pool::io_pool(const unsigned int& count) : 
+            tasks(new queue()), 
+            threads()
+    {
+        for(unsigned int x(0); x < std::max(1u, count); ++x) this->threads.emplace_back(&io_pool::work, this->tasks);
+    }
+    
+    io_pool::~io_pool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(this->tasks->lock);
+            this->tasks->stop = true;
+        }
+        this->tasks->ready.notify_all();
+        
+        //a job dropping the last reference to the pool can not wait for its own thread:
+        const std::thread::id self(std::this_thread::get_id());
+        for(std::thread& t : this->threads)
+        {
+            if(t.get_id() == self) t.detach();
+            else t.join();
+        }
+    }
+    
+    /**
+     * @brief Queues a job to run on one of the pool's threads.
+     */
+    void io_pool::post(const std::function<void()>& job)
+    {
+        {
+            std::lock_guard<std::mutex> guard(this->tasks->lock);
+            this->tasks->jobs.push_back(job);
+        }
+        this->tasks->ready.notify_one();
+    }
+    
+    /**
+     * @return The pool used when async_options does not name one.  It is
+     * made on first use, with 4 threads.
+     */
+    std::shared_ptr<io_pool> io_pool::shared()
+    {
+        static std::shared_ptr<io_pool> pool(new io_pool());
+        return pool;
+    }
+    
+    /**
+     * @brief Runs on each thread: runs jobs until the pool is destroyed and
+     * none are left.
+     */
+    void io_pool::work(const std::shared_ptr<queue>& q)
+    {
+        while(true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> guard(q->lock);
+                q->ready.wait(guard, [&q](){ return (q->stop || !q->jobs.empty()); });
+                if(q->jobs.empty()) break;
+                job = std::move(q->jobs.front());
+                q->jobs.pop_front();
+            }
+            job();
+        }
+    }
+    
+    
+}
+
+//async_walk member functions:
+namespace filesystem
+{
+    async_options::async_options() : 
+            pool(), 
+            resume(), 
+            batch(256)
+    {
+    }
+    
+    /* Only one next() is awaited at a time, and the pool's queue orders the
+     * hand-off to and from its threads, so this needs no lock of its own. */
+    struct async_walk::state
+    {
+        state(const source_type& s, const async_options& o) : 
+                source(s), 
+                options(o), 
+                entries(), 
+                done(false), 
+                error()
+        {
+            if(!this->options.pool) this->options.pool = io_pool::shared();
+            this->options.batch = std::max<std::size_t>(1, this->options.batch);
+        }
+        
+        /**
+         * @brief Reads up to a batch of entries.  Runs on the pool.
+         */
+        void fill()
+        {
+            try
+            {
+                directory_entry entry;
+                while((this->entries.size() < this->options.batch) && !this->done)
+                {
+                    if(this->source(entry)) this->entries.push_back(entry);
+                    else this->done = true;
+                }
+            }
+            catch(...)
+            {
+                this->error = std::current_exception();
+                this->done = true;
+            }
+        }
+        
+        source_type source;
+        async_options options;
+        std::deque<directory_entry> entries;
+        bool done;
+        std::exception_ptr error;
+    };
+    
+    async_walk::awaiter::awaiter(const std::shared_ptr<state>& s) : 
+            impl(s)
+    {
+    }
+    
+    /**
+     * @return true if the next entry (or the end) is already known, so the
+     * coroutine need not suspend.
+     */
+    bool async_walk::awaiter::await_ready() const
+    {
+        return (!this->impl || !this->impl->entries.empty() || this->impl->done);
+    }
+    
+    void async_walk::awaiter::await_suspend(std::coroutine_handle<> h) const
+    {
+        std::shared_ptr<state> s(this->impl);
+        s->options.pool->post([s, h]()
+                {
+                    s->fill();
+                    resume(s->options, h);
+                });
+    }
+    
+    /**
+     * @return The next entry, or nothing at the end.
+     */
+    std::optional<directory_entry> async_walk::awaiter::await_resume() const
+    {
+        if(!this->impl) return std::nullopt;
+        if(!this->impl->entries.empty())
+        {
+            std::optional<directory_entry> entry(std::move(this->impl->entries.front()));
+            this->impl->entries.pop_front();
+            return entry;
+        }
+        if(this->impl->error)
+        {
+            std::exception_ptr e(this->impl->error);
+            this->impl->error = nullptr;
+            std::rethrow_exception(e);
+        }
+        return std::nullopt;
+    }
+    
+    /**
+     * @brief A walk that is already at its end.
+     */
+    async_walk::async_walk() : 
+            impl()
+    {
+    }
+    
+    /**
+     * @brief Walks a folder recursively.  Nothing is read until the first
+     * next(), and then only on the pool.
+     */
+    async_walk::async_walk(const path& p, const traversal_options& t, const async_options& o) : 
+            impl()
+    {
+        std::shared_ptr<recursive_iterator> it;
+        this->impl.reset(new state([p, t, it](directory_entry& entry) mutable
+                {
+                    if(!it) it.reset(new recursive_iterator(p, t));
+                    else if(!it->end()) ++(*it);
+                    if(it->end()) return false;
+                    entry = **it;
+                    return true;
+                }, o));
+    }
+    
+    /**
+     * @brief Continues a traversal from where "it" is.  "it" is copied.
+     */
+    async_walk::async_walk(const recursive_iterator& it, const async_options& o) : 
+            impl(new state(make_source(it), o))
+    {
+    }
+    
+    async_walk::async_walk(const recursive_glob& it, const async_options& o) : 
+            impl(new state(make_source(it), o))
+    {
+    }
+    
+    async_walk::async_walk(const glob& it, const async_options& o) : 
+            impl(new state(make_source(it), o))
+    {
+    }
+    
+    async_walk::async_walk(const async_walk& w) : 
+            impl(w.impl)
+    {
+    }
+    
+    async_walk::~async_walk()
+    {
+    }
+    
+    async_walk& async_walk::operator=(const async_walk& w)
+    {
+        if(this != &w)
+        {
+            this->impl = w.impl;
+        }
+        return *this;
+    }
+    
+    /**
+     * @brief "co_await" the result for the next entry.
+     */
+    async_walk::awaiter async_walk::next() const
+    {
+        return awaiter(this->impl);
+    }
+    
+    void async_walk::swap(async_walk& w)
+    {
+        std::swap(this->impl, w.impl);
+    }
+    
+    
+}
+
+//async_copy member functions:
+namespace filesystem
+{
+    struct async_copy::state
+    {
+        /**
+         * @brief Copies up to a batch of entries on the pool, then posts
+         * itself again, so the copy does not hold a pool thread to itself.
+         * Resumes "h" at the end, or on the first error.
+         */
+        static void run(const std::shared_ptr<state>& s, const std::coroutine_handle<>& h)
+        {
+            bool done(false);
+            try
+            {
+                std::size_t count(0);
+                if(!s->it)
+                {
+                    s->it.reset(new copy_iterator(s->source, s->dest, s->options, s->traversal));
+                    ++count;
+                }
+                for(; (count < s->async.batch) && !s->it->end(); ++count)
+                {
+                    ++(s->copied);
+                    ++(*(s->it));
+                }
+                done = s->it->end();
+            }
+            catch(...)
+            {
+                s->error = std::current_exception();
+                done = true;
+            }
+            if(done)
+            {
+                s->it.reset();
+                resume(s->async, h);
+            }
+            else s->async.pool->post([s, h](){ run(s, h); });
+        }
+        
+        path source, dest;
+        copy_options options;
+        traversal_options traversal;
+        async_options async;
+        std::shared_ptr<copy_iterator> it;
+        std::uintmax_t copied;
+        std::exception_ptr error;
+    };
+    
+    /**
+     * @param from The folder to copy.
+     * @param to Where to copy it to.
+     */
+    async_copy::async_copy(const path& from, const path& to, const copy_options& c, const traversal_options& t, 
+            const async_options& a) : 
+            impl(new state{from, to, c, t, a, nullptr, 0, nullptr})
+    {
+        if(!this->impl->async.pool) this->impl->async.pool = io_pool::shared();
+        this->impl->async.batch = std::max<std::size_t>(1, this->impl->async.batch);
+    }
+    
+    bool async_copy::await_ready() const
+    {
+        return false;
+    }
+    
+    void async_copy::await_suspend(std::coroutine_handle<> h) const
+    {
+        std::shared_ptr<state> s(this->impl);
+        s->async.pool->post([s, h](){ state::run(s, h); });
+    }
+    
+    /**
+     * @return The number of entries copied.
+     */
+    std::uintmax_t async_copy::await_resume() const
+    {
+        if(this->impl->error) std::rethrow_exception(this->impl->error);
+        return this->impl->copied;
+    }
+    
+    
+}
+
+#endif
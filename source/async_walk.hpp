@@ -0,0 +1,173 @@
+#ifndef UTILITY_ASYNC_WALK_HPP_INCLUDED
+#define UTILITY_ASYNC_WALK_HPP_INCLUDED
+
+/* Coroutines need C++20 (CPLUSPLUS_20 in CMakeLists.txt). */
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+#error "async_walk.hpp needs C++20 coroutines: set CPLUSPLUS_20 in CMakeLists.txt"
+#endif
+
+#include <boost/filesystem.hpp>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "filesystem.hpp"
+
+namespace filesystem
+{
+    class io_pool;
+    struct async_options;
+    class async_walk;
+    class async_copy;
+    
+    
+    /**
+     * @class io_pool
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file async_walk.hpp
+     * @brief A few threads that run the blocking work (directory reads, stats,
+     * copies) of suspended coroutines, so many walks can share them.  Jobs
+     * run in the order they are posted.  The destructor finishes the jobs
+     * already posted.  A pool must outlive the walks and copies using it;
+     * they hold on to it for that, so its last owner may be one of its own
+     * jobs.  Destroyed on one of its own threads, it does not wait for that
+     * thread, which finishes its job and exits on its own.
+     */
+    class io_pool
+    {
+    public:
+        explicit io_pool(const unsigned int& = 4);
+        io_pool(const io_pool&) = delete;
+        ~io_pool();
+        
+        io_pool& operator=(const io_pool&) = delete;
+        
+        void post(const std::function<void()>&);
+        
+        static std::shared_ptr<io_pool> shared();
+    
+    private:
+        struct queue;
+        
+        static void work(const std::shared_ptr<queue>&);
+        
+        /* Shared with the threads, which may outlive the pool. */
+        std::shared_ptr<queue> tasks;
+        std::vector<std::thread> threads;
+    };
+    
+    /**
+     * @struct async_options
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file async_walk.hpp
+     * @brief Where the work of an async_walk or async_copy runs, and where the
+     * coroutine waiting on it resumes.
+     */
+    struct async_options
+    {
+        explicit async_options();
+        
+        /* The threads doing the I/O.  Defaults to io_pool::shared().  The
+         * walk or copy keeps it alive until its last job is done. */
+        std::shared_ptr<io_pool> pool;
+        
+        /* Called on a pool thread with the coroutine to resume once its work
+         * is done.  An event loop should hand it back to its own thread here.
+         * If empty, the coroutine resumes on the pool thread. */
+        std::function<void(std::coroutine_handle<>)> resume;
+        
+        /* The most entries an async_walk reads, or an async_copy copies, per
+         * trip to the pool. */
+        std::size_t batch;
+    };
+    
+    /**
+     * @class async_walk
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file async_walk.hpp
+     * @brief An asynchronous generator of the entries of a traversal.
+     * "co_await next()" gives the next entry, or nothing at the end.  Entries
+     * are read on the io_pool in batches, and the coroutine is only suspended
+     * when the batch it has is used up.  Errors of the traversal are thrown
+     * from the co_await.  Only one next() may be awaited at a time.  Copies
+     * share their position.
+     */
+    class async_walk
+    {
+    public:
+        struct state;
+        
+        class awaiter
+        {
+        public:
+            explicit awaiter(const std::shared_ptr<state>&);
+            
+            bool await_ready() const;
+            void await_suspend(std::coroutine_handle<>) const;
+            std::optional<boost::filesystem::directory_entry> await_resume() const;
+        
+        private:
+            std::shared_ptr<state> impl;
+        };
+        
+        explicit async_walk();
+        async_walk(const boost::filesystem::path&, const traversal_options& = traversal_options(), 
+                const async_options& = async_options());
+        async_walk(const recursive_iterator&, const async_options& = async_options());
+        async_walk(const recursive_glob&, const async_options& = async_options());
+        async_walk(const glob&, const async_options& = async_options());
+        async_walk(const async_walk&);
+        
+        virtual ~async_walk();
+        
+        virtual async_walk& operator=(const async_walk&);
+        
+        awaiter next() const;
+        void swap(async_walk&);
+    
+    private:
+        std::shared_ptr<state> impl;
+    };
+    
+    /**
+     * @class async_copy
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file async_walk.hpp
+     * @brief Recursively copies a folder into another folder, like running a
+     * copy_iterator to its end, on the io_pool, a batch of entries per job.
+     * "co_await" it for the number of entries copied; errors are thrown from
+     * the co_await.  It can be awaited once.
+     */
+    class async_copy
+    {
+    public:
+        async_copy(const boost::filesystem::path&, const boost::filesystem::path&, const copy_options& = copy_options(), 
+                const traversal_options& = traversal_options(), const async_options& = async_options());
+        
+        bool await_ready() const;
+        void await_suspend(std::coroutine_handle<>) const;
+        std::uintmax_t await_resume() const;
+    
+    private:
+        struct state;
+        
+        std::shared_ptr<state> impl;
+    };
+    
+    
+}
+
+#endif
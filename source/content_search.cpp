@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include <boost/regex.hpp>
+
+#include "content_search.hpp"
+#include "literal_scan.hpp"
+
+using boost::filesystem::path;
+using boost::filesystem::directory_entry;
+
+namespace
+{
+    //how much of a file is read at a time:
+    const std::size_t read_size(1024 * 1024);
+    
+    const char* line_start(const char*, const char*);
+    const char* line_end(const char*, const char*);
+    
+    
+    /**
+     * @return The start of the line "p" is on.  "begin" is the start of the buffer.
+     */
+    inline const char* line_start(const char* begin, const char* p)
+    {
+        const void* n(memrchr(begin, '\n', static_cast<std::size_t>(p - begin)));
+        return ((n == nullptr) ? begin : (static_cast<const char*>(n) + 1));
+    }
+    
+    /**
+     * @return The newline ending the line "p" is on, or "end".
+     */
+    inline const char* line_end(const char* p, const char* end)
+    {
+        const void* n(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+        return ((n == nullptr) ? end : static_cast<const char*>(n));
+    }
+    
+    
+}
+
+namespace filesystem
+{
+    search_options::search_options() : 
+            pattern(),
+            literal(true),
+            threads(std::max(1u, std::thread::hardware_concurrency()))
+    {
+    }
+    
+    struct content_search::state
+    {
+        typedef std::function<bool(directory_entry&)> source_type;
+        
+        state(const source_type& s, const search_options& o) : 
+                source(s),
+                finder(o.literal ? o.pattern : required_literal(o.pattern)),
+                expression(),
+                use_regex(!o.literal),
+                source_lock(),
+                lock(),
+                ready(),
+                room(),
+                batches(),
+                max_batches(4 * std::max(1u, o.threads)),
+                running(std::max(1u, o.threads)),
+                error(),
+                stop(false),
+                current(),
+                index(0),
+                workers()
+        {
+            if(this->use_regex) this->expression.assign(o.pattern, boost::regex::perl);
+            
+            //workers that finish early count "running" down while others are still being started:
+            const unsigned int threads(this->running);
+            for(unsigned int x(0); x < threads; ++x) this->workers.emplace_back(&state::work, this);
+        }
+        
+        ~state()
+        {
+            {
+                std::lock_guard<std::mutex> guard(this->lock);
+                this->stop = true;
+            }
+            this->room.notify_all();
+            for(std::thread& t : this->workers) t.join();
+        }
+        
+        /**
+         * @brief Moves to the next hit, waiting for the search threads if need be.
+         * @return false when there are no more.
+         */
+        bool next()
+        {
+            if(++(this->index) < this->current.size()) return true;
+            
+            std::unique_lock<std::mutex> guard(this->lock);
+            this->ready.wait(guard, [this](){ return (!this->batches.empty() || (this->running == 0)); });
+            if(this->batches.empty())
+            {
+                if(this->error) std::rethrow_exception(this->error);
+                return false;
+            }
+            this->current = std::move(this->batches.front());
+            this->batches.pop_front();
+            this->index = 0;
+            guard.unlock();
+            this->room.notify_one();
+            return true;
+        }
+        
+        /**
+         * @brief Runs on each search thread: takes files from the source until
+         * it runs out, and queues the hits of each.
+         */
+        void work()
+        {
+            try
+            {
+                directory_entry entry;
+                while(true)
+                {
+                    {
+                        std::lock_guard<std::mutex> guard(this->lock);
+                        if(this->stop) break;
+                    }
+                    {
+                        std::lock_guard<std::mutex> guard(this->source_lock);
+                        if(!this->source(entry)) break;
+                    }
+                    if(!boost::filesystem::is_regular_file(entry.symlink_status())) continue;
+                    
+                    std::vector<search_hit> hits;
+                    this->search(entry.path(), hits);
+                    if(hits.empty()) continue;
+                    
+                    std::unique_lock<std::mutex> guard(this->lock);
+                    this->room.wait(guard, [this](){ return (this->stop || (this->batches.size() < this->max_batches)); });
+                    if(this->stop) break;
+                    this->batches.push_back(std::move(hits));
+                    guard.unlock();
+                    this->ready.notify_one();
+                }
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> guard(this->lock);
+                if(!this->error) this->error = std::current_exception();
+                this->stop = true;
+            }
+            {
+                std::lock_guard<std::mutex> guard(this->lock);
+                --(this->running);
+            }
+            this->ready.notify_all();
+            this->room.notify_all();
+        }
+        
+        /**
+         * @brief Searches one file, a buffer of whole lines at a time.  A file
+         * is read rather than mapped, so one that shrinks under the search
+         * (a log truncated by rotation, say) just ends early.
+         */
+        void search(const path& p, std::vector<search_hit>& hits) const
+        {
+            int fd(::open(p.c_str(), (O_RDONLY | O_CLOEXEC)));
+            if(fd == -1) return;
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            
+            //the front of the buffer holds "kept" bytes of a line that did not end in the last read:
+            std::vector<char> buffer(read_size);
+            std::size_t kept(0);
+            std::uintmax_t base(0), line(1);
+            bool ended(false);
+            while(!ended)
+            {
+                //a line longer than the buffer:
+                if(kept == buffer.size()) buffer.resize(buffer.size() * 2);
+                
+                ssize_t n(pread(fd, (buffer.data() + kept), (buffer.size() - kept), static_cast<off_t>(base + kept)));
+                if((n == -1) && (errno == EINTR)) continue;
+                ended = (n <= 0);
+                
+                const char* begin(buffer.data());
+                const char* end(begin + kept + ((n > 0) ? n : 0));
+                const char* last(end);
+                if(!ended)
+                {
+                    const void* newline(memrchr(begin, '\n', static_cast<std::size_t>(end - begin)));
+                    last = ((newline == nullptr) ? begin : (static_cast<const char*>(newline) + 1));
+                }
+                this->scan(p, begin, last, base, line, hits);
+                
+                kept = static_cast<std::size_t>(end - last);
+                std::memmove(buffer.data(), last, kept);
+                base += static_cast<std::uintmax_t>(last - begin);
+            }
+            ::close(fd);
+        }
+        
+        /**
+         * @brief Finds the matching lines in a buffer of whole lines.
+         * @param base The offset of "begin" in the file.
+         * @param line The number of the line at "begin"; moved past the buffer.
+         */
+        void scan(const path& p, const char* begin, const char* end, const std::uintmax_t& base, 
+                std::uintmax_t& line, std::vector<search_hit>& hits) const
+        {
+            const char* counted(begin);
+            
+            //"pos" is always at the start of a line:
+            for(const char* pos(begin); pos < end;)
+            {
+                const char* found(this->finder.find(pos, end));
+                if(found == end) break;
+                
+                const char* start(line_start(pos, found));
+                const char* stop(line_end(found, end));
+                const char* match(found);
+                if(this->use_regex)
+                {
+                    boost::cmatch result;
+                    if(!boost::regex_search(start, stop, result, this->expression)) match = nullptr;
+                    else match = result[0].first;
+                }
+                
+                if(match != nullptr)
+                {
+                    line += static_cast<std::uintmax_t>(std::count(counted, start, '\n'));
+                    counted = start;
+                    hits.push_back(search_hit{p, line, (base + static_cast<std::uintmax_t>(match - begin)), 
+                            std::string(start, stop)});
+                }
+                pos = (stop + 1);
+            }
+            line += static_cast<std::uintmax_t>(std::count(counted, end, '\n'));
+        }
+        
+        source_type source;
+        literal_finder finder;
+        boost::regex expression;
+        bool use_regex;
+        std::mutex source_lock;
+        
+        //guards everything below, except "current" and "index", which only the iterator touches:
+        std::mutex lock;
+        std::condition_variable ready, room;
+        std::deque<std::vector<search_hit> > batches;
+        const std::size_t max_batches;
+        unsigned int running;
+        std::exception_ptr error;
+        bool stop;
+        
+        std::vector<search_hit> current;
+        std::size_t index;
+        std::vector<std::thread> workers;
+    };
+    
+    content_search::content_search() : 
+            impl()
+    {
+    }
+    
+    /**
+     * @param it Where the files to search come from.  Its current entry is the first.
+     * @param o What to search for.
+     */
+    content_search::content_search(const recursive_iterator& it, const search_options& o) : 
+            impl()
+    {
+        recursive_iterator i(it);
+        this->start([i](directory_entry& e) mutable
+                {
+                    if(i.end()) return false;
+                    e = *i;
+                    ++i;
+                    return true;
+                }, o);
+    }
+    
+    content_search::content_search(const recursive_glob& it, const search_options& o) : 
+            impl()
+    {
+        recursive_glob i(it);
+        this->start([i](directory_entry& e) mutable
+                {
+                    if(i.end()) return false;
+                    e = *i;
+                    ++i;
+                    return true;
+                }, o);
+    }
+    
+    content_search::content_search(const glob& it, const search_options& o) : 
+            impl()
+    {
+        glob i(it);
+        this->start([i](directory_entry& e) mutable
+                {
+                    if(i.end()) return false;
+                    e = *i;
+                    ++i;
+                    return true;
+                }, o);
+    }
+    
+    content_search::content_search(const content_search& c) : 
+            impl(c.impl)
+    {
+    }
+    
+    content_search::~content_search()
+    {
+    }
+    
+    content_search& content_search::operator=(const content_search& c)
+    {
+        if(this != &c)
+        {
+            this->impl = c.impl;
+        }
+        return *this;
+    }
+    
+    content_search& content_search::operator++()
+    {
+        if(this->end()) return *this;
+        if(!this->impl->next()) this->impl.reset();
+        return *this;
+    }
+    
+    content_search content_search::operator++(int)
+    {
+        content_search newit(*this);
+        ++(*this);
+        return newit;
+    }
+    
+    bool content_search::operator!=(const content_search& c) const
+    {
+        return (this->impl != c.impl);
+    }
+    
+    bool content_search::operator==(const content_search& c) const
+    {
+        return (this->impl == c.impl);
+    }
+    
+    const search_hit& content_search::operator*() const
+    {
+        return this->impl->current[this->impl->index];
+    }
+    
+    const search_hit* content_search::operator->() const
+    {
+        return &(this->impl->current[this->impl->index]);
+    }
+    
+    void content_search::swap(content_search& c)
+    {
+        content_search tempit(c);
+        c = (*this);
+        (*this) = tempit;
+    }
+    
+    /**
+     * @return true if at end.
+     */
+    bool content_search::end() const
+    {
+        return !(this->impl);
+    }
+    
+    /**
+     * @brief Starts the search threads, and waits for the first hit.
+     */
+    void content_search::start(const std::function<bool(directory_entry&)>& source, const search_options& o)
+    {
+        this->impl.reset(new state(source, o));
+        
+        //"index" wraps around to 0 on the first call:
+        this->impl->index = static_cast<std::size_t>(-1);
+        if(!this->impl->next()) this->impl.reset();
+    }
+    
+    
+}
@@ -0,0 +1,109 @@
+#ifndef UTILITY_CONTENT_SEARCH_HPP_INCLUDED
+#define UTILITY_CONTENT_SEARCH_HPP_INCLUDED
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "filesystem.hpp"
+
+namespace filesystem
+{
+    struct search_options;
+    struct search_hit;
+    class content_search;
+    
+    
+    /**
+     * @struct search_options
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file content_search.hpp
+     * @brief What a content_search looks for, and how.
+     */
+    struct search_options
+    {
+        explicit search_options();
+        
+        /* The text to find.  If "literal" is false it is a Perl-syntax regex,
+         * matched one line at a time. */
+        std::string pattern;
+        bool literal;
+        
+        /* The number of files searched at once.  Defaults to the number of CPUs. */
+        unsigned int threads;
+    };
+    
+    /**
+     * @struct search_hit
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file content_search.hpp
+     * @brief A line that matched.
+     */
+    struct search_hit
+    {
+        boost::filesystem::path path;
+        
+        //counted from 1:
+        std::uintmax_t line;
+        
+        //the byte offset in the file of the first match on the line:
+        std::uintmax_t offset;
+        
+        //the line, without its newline:
+        std::string text;
+    };
+    
+    /**
+     * @class content_search
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file content_search.hpp
+     * @brief Searches the contents of the regular files a glob (or any
+     * recursive_iterator) yields, and iterates over the lines that match.
+     * Files are read in large blocks and searched on several threads; a literal
+     * pattern, or the longest literal every match of a regex must contain, is
+     * located with literal_finder before anything slower runs.  The hits of one
+     * file come together and in order, but files come in whatever order they
+     * finish.  Files that can not be read are skipped.  The source is 
+     * advanced by the search threads, so leave it alone until the search
+     * ends.  Copies share their position.
+     */
+    class content_search
+    {
+    public:
+        explicit content_search();
+        content_search(const recursive_iterator&, const search_options&);
+        content_search(const recursive_glob&, const search_options&);
+        content_search(const glob&, const search_options&);
+        content_search(const content_search&);
+        
+        virtual ~content_search();
+        
+        virtual content_search& operator=(const content_search&);
+        virtual content_search& operator++();
+        content_search operator++(int);
+        
+        bool operator!=(const content_search&) const;
+        bool operator==(const content_search&) const;
+        
+        const search_hit& operator*() const;
+        const search_hit* operator->() const;
+        void swap(content_search&);
+        
+        bool end() const;
+        
+    private:
+        struct state;
+        
+        void start(const std::function<bool(boost::filesystem::directory_entry&)>&, const search_options&);
+        
+        std::shared_ptr<state> impl;
+    };
+    
+    
+}
+
+#endif
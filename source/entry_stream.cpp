@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+
+#include "entry_stream.hpp"
+
+using boost::filesystem::path;
+using boost::filesystem::directory_entry;
+
+namespace
+{
+    const char magic[] = "FSENTRY2";
+    const std::size_t magic_size(sizeof(magic) - 1);
+    
+    //the fields a stream can hold:
+    const unsigned int stored_fields(filesystem::file_metadata::type_field | filesystem::file_metadata::size_field | 
+            filesystem::file_metadata::mtime_field | filesystem::file_metadata::inode_field);
+    
+    void put_varint(std::string&, std::uint64_t);
+    bool get_varint(const unsigned char*&, const unsigned char*, std::uint64_t&);
+    void corrupt(const path&);
+    
+    
+    /**
+     * @brief Appends an unsigned LEB128 varint.
+     */
+    inline void put_varint(std::string& s, std::uint64_t v)
+    {
+        while(v >= 0x80)
+        {
+            s += static_cast<char>((v & 0x7f) | 0x80);
+            v >>= 7;
+        }
+        s += static_cast<char>(v);
+    }
+    
+    /**
+     * @brief Decodes an unsigned LEB128 varint.
+     * @return false if it runs past "end".
+     */
+    inline bool get_varint(const unsigned char*& p, const unsigned char* end, std::uint64_t& v)
+    {
+        v = 0;
+        for(unsigned int shift(0); ((p < end) && (shift < 64)); shift += 7)
+        {
+            v |= (static_cast<std::uint64_t>(*p & 0x7f) << shift);
+            if((*(p++) & 0x80) == 0) return true;
+        }
+        return false;
+    }
+    
+    inline void corrupt(const path& p)
+    {
+        using boost::filesystem::filesystem_error;
+        using boost::system::error_code;
+        using boost::system::system_category;
+        
+        throw filesystem_error("Corrupt entry stream!", p, error_code(EILSEQ, system_category()));
+    }
+    
+    
+}
+
+//entry_writer member functions:
+namespace filesystem
+{
+    /**
+     * @param o The stream to write to.
+     * @param f The file_metadata fields to store with every entry.  Only the
+     * type, size, mtime and inode fields can be stored.
+     */
+    entry_writer::entry_writer(std::ostream& o, const unsigned int& f) : 
+            out(o),
+            fields(f & stored_fields),
+            previous(),
+            record()
+    {
+        this->out.write(magic, magic_size);
+    }
+    
+    entry_writer::~entry_writer()
+    {
+        this->out.flush();
+    }
+    
+    /**
+     * @brief Writes one entry.
+     * @param p The entry's path.
+     * @param md The entry's metadata.  Fields the writer was asked to store
+     * but md does not have are left out of the record.
+     */
+    void entry_writer::write(const path& p, const file_metadata& md)
+    {
+        const std::string& s(p.native());
+        std::size_t shared(0);
+        const std::size_t limit(std::min(s.size(), this->previous.size()));
+        while((shared < limit) && (s[shared] == this->previous[shared])) ++shared;
+        
+        const unsigned int present(this->fields & md.valid);
+        std::string& body(this->record);
+        body.clear();
+        put_varint(body, shared);
+        put_varint(body, (s.size() - shared));
+        body.append(s, shared, std::string::npos);
+        body += static_cast<char>(present);
+        if(present & file_metadata::type_field) body += static_cast<char>(md.type);
+        if(present & file_metadata::size_field) put_varint(body, md.size);
+        if(present & file_metadata::mtime_field)
+        {
+            const std::int64_t t(md.mtime);
+            put_varint(body, ((static_cast<std::uint64_t>(t) << 1) ^ static_cast<std::uint64_t>(t >> 63)));
+        }
+        if(present & file_metadata::inode_field)
+        {
+            put_varint(body, md.device);
+            put_varint(body, md.inode);
+            put_varint(body, md.links);
+            put_varint(body, md.rdev);
+        }
+        
+        std::string length;
+        put_varint(length, body.size());
+        this->out.write(length.data(), length.size());
+        this->out.write(body.data(), body.size());
+        this->previous = s;
+    }
+    
+    /**
+     * @brief Writes the current entry of a traversal, reusing the metadata it
+     * has already gathered.
+     */
+    void entry_writer::write(recursive_iterator& it)
+    {
+        if(this->fields == 0) this->write(it->path());
+        else this->write(it->path(), it.metadata(this->fields));
+    }
+    
+    
+}
+
+//entry_reader member functions:
+namespace filesystem
+{
+    struct entry_reader::state
+    {
+        explicit state(const path& p) : 
+                source(p),
+                data(nullptr),
+                size(0),
+                next(nullptr),
+                current(),
+                meta(),
+                entry(),
+                stale(true)
+        {
+        }
+        
+        ~state()
+        {
+            if(this->data != nullptr) munmap(const_cast<unsigned char*>(this->data), this->size);
+        }
+        
+        /**
+         * @brief Decodes the next record.
+         * @return false at the end of the stream.
+         */
+        bool advance()
+        {
+            const unsigned char* end(this->data + this->size);
+            if(this->next >= end) return false;
+            
+            std::uint64_t length(0), shared(0), suffix(0);
+            if(!get_varint(this->next, end, length) || (length > static_cast<std::uint64_t>(end - this->next))) corrupt(this->source);
+            const unsigned char* p(this->next);
+            const unsigned char* record_end(this->next + length);
+            this->next = record_end;
+            
+            if(!get_varint(p, record_end, shared) || !get_varint(p, record_end, suffix) || 
+                    (shared > this->current.size()) || (suffix > static_cast<std::uint64_t>(record_end - p))) corrupt(this->source);
+            this->current.resize(shared);
+            this->current.append(reinterpret_cast<const char*>(p), suffix);
+            p += suffix;
+            
+            this->meta = file_metadata();
+            if(p >= record_end) corrupt(this->source);
+            const unsigned int present(*(p++));
+            if(present & file_metadata::type_field)
+            {
+                if(p >= record_end) corrupt(this->source);
+                this->meta.type = static_cast<boost::filesystem::file_type>(*(p++));
+            }
+            std::uint64_t v(0);
+            if(present & file_metadata::size_field)
+            {
+                if(!get_varint(p, record_end, v)) corrupt(this->source);
+                this->meta.size = v;
+            }
+            if(present & file_metadata::mtime_field)
+            {
+                if(!get_varint(p, record_end, v)) corrupt(this->source);
+                this->meta.mtime = static_cast<std::time_t>(static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1));
+            }
+            if(present & file_metadata::inode_field)
+            {
+                if(!get_varint(p, record_end, v)) corrupt(this->source);
+                this->meta.device = v;
+                if(!get_varint(p, record_end, v)) corrupt(this->source);
+                this->meta.inode = v;
+                if(!get_varint(p, record_end, v)) corrupt(this->source);
+                this->meta.links = v;
+                if(!get_varint(p, record_end, v)) corrupt(this->source);
+                this->meta.rdev = v;
+            }
+            this->meta.valid = present;
+            this->stale = true;
+            return true;
+        }
+        
+        /**
+         * @return The current entry, built only when somebody asks for it.
+         */
+        directory_entry& get()
+        {
+            if(this->stale)
+            {
+                using boost::filesystem::file_status;
+                
+                //a link's target was not recorded, so only its own type is known:
+                file_status st, symlink_st;
+                if(this->meta.valid & file_metadata::type_field)
+                {
+                    symlink_st = file_status(this->meta.type);
+                    if(this->meta.type != boost::filesystem::symlink_file) st = symlink_st;
+                }
+                this->entry.assign(path(this->current), st, symlink_st);
+                this->stale = false;
+            }
+            return this->entry;
+        }
+        
+        path source;
+        const unsigned char* data;
+        std::size_t size;
+        const unsigned char* next;
+        std::string current;
+        file_metadata meta;
+        directory_entry entry;
+        bool stale;
+    };
+    
+    entry_reader::entry_reader() : 
+            impl()
+    {
+    }
+    
+    /**
+     * @brief Maps a saved stream and positions the reader at its first entry.
+     */
+    entry_reader::entry_reader(const path& p) : 
+            impl(new state(p))
+    {
+        using boost::filesystem::filesystem_error;
+        using boost::system::error_code;
+        using boost::system::system_category;
+        
+        int fd(::open(p.c_str(), (O_RDONLY | O_CLOEXEC)));
+        if(fd == -1) throw filesystem_error("Can not open entry stream!", p, error_code(errno, system_category()));
+        
+        struct stat st;
+        if(fstat(fd, &st) == -1)
+        {
+            int e(errno);
+            ::close(fd);
+            throw filesystem_error("Can not open entry stream!", p, error_code(e, system_category()));
+        }
+        if(static_cast<std::size_t>(st.st_size) < magic_size)
+        {
+            ::close(fd);
+            corrupt(p);
+        }
+        
+        void* m(mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0));
+        ::close(fd);
+        if(m == MAP_FAILED) throw filesystem_error("Can not map entry stream!", p, error_code(errno, system_category()));
+        madvise(m, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+        
+        this->impl->data = static_cast<const unsigned char*>(m);
+        this->impl->size = static_cast<std::size_t>(st.st_size);
+        if(std::memcmp(this->impl->data, magic, magic_size) != 0) corrupt(p);
+        this->impl->next = (this->impl->data + magic_size);
+        if(!this->impl->advance()) this->impl.reset();
+    }
+    
+    entry_reader::entry_reader(const entry_reader& r) : 
+            impl(r.impl)
+    {
+    }
+    
+    entry_reader::~entry_reader()
+    {
+    }
+    
+    entry_reader& entry_reader::operator=(const entry_reader& r)
+    {
+        if(this != &r)
+        {
+            this->impl = r.impl;
+        }
+        return *this;
+    }
+    
+    entry_reader& entry_reader::operator++()
+    {
+        if(this->end()) return *this;
+        if(!this->impl->advance()) this->impl.reset();
+        return *this;
+    }
+    
+    entry_reader entry_reader::operator++(int)
+    {
+        entry_reader newit(*this);
+        ++(*this);
+        return newit;
+    }
+    
+    bool entry_reader::operator!=(const entry_reader& r) const
+    {
+        return (this->impl != r.impl);
+    }
+    
+    bool entry_reader::operator==(const entry_reader& r) const
+    {
+        return (this->impl == r.impl);
+    }
+    
+    directory_entry& entry_reader::operator*()
+    {
+        return this->impl->get();
+    }
+    
+    directory_entry* entry_reader::operator->()
+    {
+        return &(this->impl->get());
+    }
+    
+    void entry_reader::swap(entry_reader& r)
+    {
+        entry_reader tempit(r);
+        r = (*this);
+        (*this) = tempit;
+    }
+    
+    /**
+     * @return true if at end.
+     */
+    bool entry_reader::end() const
+    {
+        return !(this->impl);
+    }
+    
+    /**
+     * @return The metadata stored with the current entry.  Only the fields
+     * in its "valid" mask were stored.
+     */
+    const file_metadata& entry_reader::metadata() const
+    {
+        return this->impl->meta;
+    }
+    
+    /**
+     * @return The current entry's path, without building a directory_entry.
+     */
+    const std::string& entry_reader::path_string() const
+    {
+        return this->impl->current;
+    }
+    
+    
+}
@@ -0,0 +1,94 @@
+#ifndef UTILITY_ENTRY_STREAM_HPP_INCLUDED
+#define UTILITY_ENTRY_STREAM_HPP_INCLUDED
+#include <boost/filesystem.hpp>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include "filesystem.hpp"
+
+namespace filesystem
+{
+    class entry_writer;
+    class entry_reader;
+    
+    
+    /**
+     * @class entry_writer
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file entry_stream.hpp
+     * @brief Writes traversal results as a compact binary stream instead of
+     * text.  Every record is length prefixed and stores its path as the number
+     * of leading bytes it shares with the previous path plus the rest, so a
+     * depth-first walk mostly stores file names.  The type, size, mtime and
+     * device/inode (with the link count and device number) can be stored too.
+     * Read it back with entry_reader.
+     * 
+     * Layout: the magic "FSENTRY2", then per record the varints
+     * (record length, shared prefix length, suffix length), the suffix, a byte
+     * of file_metadata fields present, and those fields: the type as one byte,
+     * then size, zigzag mtime, device, inode, links and rdev as varints.
+     */
+    class entry_writer
+    {
+    public:
+        entry_writer(std::ostream&, const unsigned int& = 0);
+        ~entry_writer();
+        
+        entry_writer(const entry_writer&) = delete;
+        entry_writer& operator=(const entry_writer&) = delete;
+        
+        void write(const boost::filesystem::path&, const file_metadata& = file_metadata());
+        void write(recursive_iterator&);
+        
+    private:
+        std::ostream& out;
+        unsigned int fields;
+        std::string previous;
+        std::string record;
+    };
+    
+    /**
+     * @class entry_reader
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file entry_stream.hpp
+     * @brief Iterates over a stream saved by entry_writer, with the same
+     * interface as recursive_iterator.  The file is memory mapped and decoded
+     * in place.  Copies share their position.
+     */
+    class entry_reader
+    {
+    public:
+        explicit entry_reader();
+        entry_reader(const boost::filesystem::path&);
+        entry_reader(const entry_reader&);
+        
+        virtual ~entry_reader();
+        
+        virtual entry_reader& operator=(const entry_reader&);
+        virtual entry_reader& operator++();
+        entry_reader operator++(int);
+        
+        bool operator!=(const entry_reader&) const;
+        bool operator==(const entry_reader&) const;
+        
+        boost::filesystem::directory_entry& operator*();
+        boost::filesystem::directory_entry* operator->();
+        void swap(entry_reader&);
+        
+        bool end() const;
+        const file_metadata& metadata() const;
+        const std::string& path_string() const;
+        
+    private:
+        struct state;
+        
+        std::shared_ptr<state> impl;
+    };
+    
+    
+}
+
+#endif
@@ -1,15 +1,102 @@
 #include <string>
+#include <vector>
+#include <map>
+#include <unordered_set>
+#include <utility>
+#include <memory>
+#include <new>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
+#include <future>
+#include <deque>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/crc.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
 
 #include "filesystem.hpp"
+#include "spsc_ring.hpp"
 
 using boost::filesystem::path;
 using boost::filesystem::directory_entry;
 
 namespace
 {
-    void copy_path(const path&, const path&, const path&);
+    struct scoped_fd;
+    struct copied_file;
+    
+    /* CRC-64/XZ, used to checksum file data as it is copied. */
+    typedef boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0xFFFFFFFFFFFFFFFFULL, 
+            0xFFFFFFFFFFFFFFFFULL, true, true> crc64;
+    
+    /**
+     * @brief A regular file that copy_path() copied.
+     */
+    struct copied_file
+    {
+        copied_file() : 
+                dest(),
+                relative(),
+                digest(0),
+                size(0),
+                linked(false)
+        {
+        }
+        
+        path dest;
+        
+        //the file's path relative to the destination folder, for the manifest:
+        path relative;
+        
+        std::uint64_t digest;
+        std::uintmax_t size;
+        
+        //true if it was hard linked to an earlier copy instead of being copied:
+        bool linked;
+    };
+    
+    /* Hashes a (device, inode) pair. */
+    struct inode_hash
+    {
+        std::size_t operator()(const std::pair<dev_t, ino_t>& i) const
+        {
+            return (std::hash<ino_t>()(i.second) ^ (std::hash<dev_t>()(i.first) * 0x9E3779B97F4A7C15ULL));
+        }
+    };
+    
+    /* Maps the (device, inode) of a multiply linked source file to its first copy. */
+    typedef std::map<std::pair<dev_t, ino_t>, copied_file> link_map;
+    
+    /* Maps the (device, inode) of a source directory to its first copy. */
+    typedef std::map<std::pair<dev_t, ino_t>, path> directory_map;
+    
+    void throw_errno(const char*, const path&, const path&);
+    std::size_t write_all(const int&, const char*, const std::size_t&);
+    void clear_direct(const int&);
+    void digest_zeros(crc64&, std::uintmax_t);
+    std::uint64_t crc64_combine(std::uint64_t, const std::uint64_t&, std::uintmax_t);
+    std::uintmax_t copy_ranges(const path&, const path&, const int&, const int&, const std::uintmax_t&, 
+            const filesystem::copy_options&, const bool&, const bool&, std::uint64_t&);
+    copied_file copy_file_data(const path&, const path&, const filesystem::copy_options&, link_map&);
+    void read_back(const path&, const copied_file&, const std::size_t&, const std::shared_ptr<filesystem::io_scheduler>&);
+    std::string escape_path(const std::string&);
+    std::string unescape_path(const std::string&);
+    void copy_copied_tree(const path&, const path&);
+    bool copy_path(const path&, const directory_entry&, const path&, const filesystem::copy_options&, 
+            link_map&, directory_map&, copied_file&, const bool&);
     std::pair<path, path> split(const path&, const path&);
     void copy_directories(const path&, const path&, const path&);
     
@@ -71,117 +158,1379 @@ namespace
         }
     }
     
+    /**
+     * @brief Closes a file descriptor when it goes out of scope.
+     */
+    struct scoped_fd
+    {
+        explicit scoped_fd(const int& f) : fd(f) {}
+        ~scoped_fd()
+        {
+            if(this->fd != -1) ::close(this->fd);
+        }
+        
+        scoped_fd(const scoped_fd&) = delete;
+        scoped_fd& operator=(const scoped_fd&) = delete;
+        
+        int fd;
+    };
+    
+    /**
+     * @brief Throws a filesystem_error describing the current errno.
+     */
+    inline void throw_errno(const char* what, const path& from, const path& to)
+    {
+        using boost::filesystem::filesystem_error;
+        using boost::system::error_code;
+        using boost::system::system_category;
+        
+        throw filesystem_error(what, from, to, error_code(errno, system_category()));
+    }
+    
+    /**
+     * @brief Writes all of a buffer, retrying short writes.
+     * @return The number of bytes written.  Less than count on error.
+     */
+    inline std::size_t write_all(const int& fd, const char* buf, const std::size_t& count)
+    {
+        std::size_t written(0);
+        while(written < count)
+        {
+            ssize_t n(::write(fd, (buf + written), (count - written)));
+            if(n == -1)
+            {
+                if(errno == EINTR) continue;
+                break;
+            }
+            written += static_cast<std::size_t>(n);
+        }
+        return written;
+    }
+    
+    /**
+     * @brief Turns O_DIRECT off for a file descriptor.
+     */
+    inline void clear_direct(const int& fd)
+    {
+#ifdef O_DIRECT
+        fcntl(fd, F_SETFL, (fcntl(fd, F_GETFL) & ~O_DIRECT));
+#else
+        (void)fd;
+#endif
+    }
+    
+    /**
+     * @brief Adds a run of zero bytes (a hole) to a checksum.
+     */
+    inline void digest_zeros(crc64& crc, std::uintmax_t count)
+    {
+        static const char zeros[4096] = {0};
+        while(count > 0)
+        {
+            std::size_t n(static_cast<std::size_t>(std::min<std::uintmax_t>(count, sizeof(zeros))));
+            crc.process_bytes(zeros, n);
+            count -= n;
+        }
+    }
+    
+    /**
+     * @brief Multiplies a vector by a matrix over GF(2).
+     */
+    inline std::uint64_t gf2_times(const std::uint64_t* matrix, std::uint64_t vector)
+    {
+        std::uint64_t sum(0);
+        for(; vector != 0; vector >>= 1, ++matrix)
+        {
+            if(vector & 1) sum ^= *matrix;
+        }
+        return sum;
+    }
+    
+    inline void gf2_square(std::uint64_t* square, const std::uint64_t* matrix)
+    {
+        for(unsigned int x(0); x < 64; ++x) square[x] = gf2_times(matrix, matrix[x]);
+    }
+    
+    /**
+     * @brief Computes the CRC-64 of two blocks of data joined together from
+     * the CRCs of each, the way zlib's crc32_combine() does.
+     * @param first The CRC of the first block.
+     * @param second The CRC of the second block.
+     * @param length The length of the second block.
+     */
+    inline std::uint64_t crc64_combine(std::uint64_t first, const std::uint64_t& second, std::uintmax_t length)
+    {
+        if(length == 0) return first;
+        
+        //the operator for one zero bit, then squared into two and four:
+        std::uint64_t even[64], odd[64];
+        odd[0] = 0xC96C5795D7870F42ULL;
+        for(unsigned int x(1); x < 64; ++x) odd[x] = (1ULL << (x - 1));
+        gf2_square(even, odd);
+        gf2_square(odd, even);
+        
+        //apply a zero byte's operator, squared once for each bit of length:
+        do
+        {
+            gf2_square(even, odd);
+            if(length & 1) first = gf2_times(even, first);
+            length >>= 1;
+            if(length == 0) break;
+            
+            gf2_square(odd, even);
+            if(length & 1) first = gf2_times(odd, first);
+            length >>= 1;
+        }while(length != 0);
+        return (first ^ second);
+    }
+    
+    /**
+     * @brief Copies a large file as several ranges at once.  The destination
+     * is preallocated first.  Without a checksum, copy_file_range lets the 
+     * kernel (or the filesystem, or the server) move the data; otherwise each
+     * thread reads and writes its own range with pread and pwrite.
+     * @param in The source, "size" bytes long.
+     * @param out The empty destination.
+     * @param direct true if both are open with O_DIRECT.
+     * @param checksum true if "digest" should be computed.
+     * @param digest Set to the CRC-64 of the data copied.
+     * @return The number of bytes copied: less than "size" if the source
+     * shrank.
+     */
+    inline std::uintmax_t copy_ranges(const path& from, const path& to, const int& in, const int& out, 
+            const std::uintmax_t& size, const filesystem::copy_options& options, const bool& direct, 
+            const bool& checksum, std::uint64_t& digest)
+    {
+        const std::size_t alignment(4096);
+        
+        if((fallocate(out, 0, 0, static_cast<off_t>(size)) == -1) && (ftruncate(out, static_cast<off_t>(size)) == -1))
+        {
+            throw_errno("Can not set destination file size!", from, to);
+        }
+        
+        //a few ranges per stream, so a slow one does not hold up the rest:
+        const unsigned int streams(std::max(1u, options.parallel_streams));
+        std::uintmax_t range((size + (streams * 4) - 1) / (streams * 4));
+        range = std::max<std::uintmax_t>(range, options.buffer_size);
+        range = (((range + alignment) - 1) / alignment) * alignment;
+        const std::size_t count(static_cast<std::size_t>((size + range - 1) / range));
+        
+        //what each range ended up as:
+        std::vector<std::uintmax_t> copied(count, 0);
+        std::vector<std::uint64_t> digests(count, 0);
+        
+        std::atomic<std::size_t> next(0);
+        std::atomic<bool> failed(false);
+        
+        //O_DIRECT is turned off at most once, for every thread:
+        std::mutex direct_lock;
+        bool direct_cleared(!direct);
+        auto drop_direct = [&]()
+        {
+            std::lock_guard<std::mutex> lock(direct_lock);
+            if(!direct_cleared)
+            {
+                clear_direct(in);
+                clear_direct(out);
+                direct_cleared = true;
+            }
+        };
+        std::mutex error_lock;
+        int error(0);
+        const char* what(nullptr);
+        
+        auto fail = [&](const char* w)
+        {
+            std::lock_guard<std::mutex> lock(error_lock);
+            if(!failed)
+            {
+                error = errno;
+                what = w;
+                failed = true;
+            }
+        };
+        
+        auto worker = [&]()
+        {
+            std::size_t buffer_size(std::max<std::size_t>(options.buffer_size, alignment));
+            buffer_size = (((buffer_size + alignment) - 1) / alignment) * alignment;
+            std::unique_ptr<char, void (*)(void*)> buffer(nullptr, &free);
+            bool use_direct(direct);
+            bool use_buffer(checksum || direct);
+            
+            for(std::size_t x(next++); ((x < count) && !failed); x = next++)
+            {
+                const off_t begin(static_cast<off_t>(x * range));
+                const off_t end(static_cast<off_t>(std::min<std::uintmax_t>(size, ((x + 1) * range))));
+                off_t offset(begin);
+                crc64 crc;
+                while((offset < end) && !failed)
+                {
+                    const std::size_t want(static_cast<std::size_t>(std::min<off_t>((end - offset), static_cast<off_t>(buffer_size))));
+                    if(options.scheduler) options.scheduler->acquire_bytes(want);
+                    const std::chrono::steady_clock::time_point started(std::chrono::steady_clock::now());
+                    ssize_t n(-1);
+                    if(!use_buffer)
+                    {
+                        loff_t in_offset(offset), out_offset(offset);
+                        n = copy_file_range(in, &in_offset, out, &out_offset, want, 0);
+                        if((n != -1) && options.scheduler) options.scheduler->report(std::chrono::steady_clock::now() - started);
+                        if((n == -1) && (errno == EINTR)) continue;
+                        if(n == -1)
+                        {
+                            //not between these two files; move the data ourselves:
+                            use_buffer = true;
+                            continue;
+                        }
+                    }
+                    else
+                    {
+                        if(!buffer)
+                        {
+                            buffer.reset(static_cast<char*>(aligned_alloc(alignment, buffer_size)));
+                            if(!buffer)
+                            {
+                                errno = ENOMEM;
+                                fail("Can not copy file!");
+                                break;
+                            }
+                        }
+                        n = pread(in, buffer.get(), want, offset);
+                        if((n == -1) && (errno == EINTR)) continue;
+                        if((n == -1) && use_direct && (errno == EINVAL))
+                        {
+                            drop_direct();
+                            use_direct = false;
+                            continue;
+                        }
+                        if(n == -1)
+                        {
+                            fail("Can not read source file!");
+                            break;
+                        }
+                        if(options.scheduler) options.scheduler->report(std::chrono::steady_clock::now() - started);
+                        if(checksum) crc.process_bytes(buffer.get(), static_cast<std::size_t>(n));
+                        
+                        ssize_t written(0);
+                        while(written < n)
+                        {
+                            ssize_t w(pwrite(out, (buffer.get() + written), static_cast<std::size_t>(n - written), (offset + written)));
+                            if((w == -1) && (errno == EINTR)) continue;
+                            if((w == -1) && use_direct && (errno == EINVAL))
+                            {
+                                //the tail of the file is not a whole number of blocks:
+                                drop_direct();
+                                use_direct = false;
+                                continue;
+                            }
+                            if(w == -1) break;
+                            written += w;
+                        }
+                        if(written < n)
+                        {
+                            fail("Can not write destination file!");
+                            break;
+                        }
+                    }
+                    if(n == 0) break;
+                    
+                    if(options.drop_cache && !use_direct)
+                    {
+                        posix_fadvise(in, offset, n, POSIX_FADV_DONTNEED);
+#ifdef SYNC_FILE_RANGE_WRITE
+                        sync_file_range(out, offset, n, SYNC_FILE_RANGE_WRITE);
+#endif
+                    }
+                    offset += n;
+                }
+                
+                if(options.drop_cache && !use_direct)
+                {
+#ifdef SYNC_FILE_RANGE_WRITE
+                    sync_file_range(out, begin, (offset - begin), 
+                            (SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER));
+#endif
+                    posix_fadvise(out, begin, (offset - begin), POSIX_FADV_DONTNEED);
+                }
+                copied[x] = static_cast<std::uintmax_t>(offset - begin);
+                digests[x] = crc.checksum();
+            }
+        };
+        
+        std::vector<std::thread> threads;
+        for(unsigned int x(1); x < std::min<std::size_t>(streams, count); ++x)
+        {
+            //the helpers end with the copy; the caller's thread is under copy_path's io_priority_scope:
+            threads.emplace_back([&]()
+                    {
+                        if(options.scheduler) options.scheduler->apply_priority();
+                        worker();
+                    });
+        }
+        worker();
+        for(std::thread& t : threads) t.join();
+        
+        if(failed)
+        {
+            unlink(to.c_str());
+            errno = error;
+            throw_errno(what, from, to);
+        }
+        
+        //the data ends where the first range came up short, if one did:
+        std::uintmax_t total(0);
+        digest = 0;
+        for(std::size_t x(0); x < count; ++x)
+        {
+            digest = ((x == 0) ? digests[x] : crc64_combine(digest, digests[x], copied[x]));
+            total += copied[x];
+            if(copied[x] < std::min<std::uintmax_t>(range, (size - (x * range)))) break;
+        }
+        if((total < size) && (ftruncate(out, static_cast<off_t>(total)) == -1))
+        {
+            int e(errno);
+            unlink(to.c_str());
+            errno = e;
+            throw_errno("Can not set destination file size!", from, to);
+        }
+        return total;
+    }
+    
+    /**
+     * @brief Copies the contents and permissions of a regular file.
+     * @param from The file to copy.
+     * @param to The new file.  It must not exist yet.
+     * @param options How to move the data.
+     * @param links The files copied so far that have more than one link.
+     * @return The copy.  Its digest is only computed if the options verify
+     * the copy or write a manifest.
+     */
+    inline copied_file copy_file_data(const path& from, const path& to, const filesystem::copy_options& options, 
+            link_map& links)
+    {
+        const bool checksum((options.verify != filesystem::copy_options::no_verify) || !options.manifest.empty());
+        copied_file result;
+        result.dest = to;
+        crc64 crc;
+        
+        //O_DIRECT wants the buffer, the file offsets and the transfer sizes aligned:
+        const std::size_t alignment(4096);
+        
+        if(options.scheduler) options.scheduler->acquire_ops();
+        scoped_fd in(::open(from.c_str(), (O_RDONLY | O_CLOEXEC)));
+        if(in.fd == -1) throw_errno("Can not open source file!", from, to);
+        
+        struct stat st;
+        if(fstat(in.fd, &st) == -1) throw_errno("Can not stat source file!", from, to);
+        
+        //a file we have already copied under another name only needs a new link:
+        const link_map::key_type key(st.st_dev, st.st_ino);
+        if(options.preserve_hardlinks && (st.st_nlink > 1))
+        {
+            link_map::const_iterator existing(links.find(key));
+            if((existing != links.end()) && (link(existing->second.dest.c_str(), to.c_str()) == 0))
+            {
+                result.digest = existing->second.digest;
+                result.size = existing->second.size;
+                result.linked = true;
+                return result;
+            }
+        }
+        
+        scoped_fd out(::open(to.c_str(), (O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC), (st.st_mode & 07777)));
+        if(out.fd == -1) throw_errno("Can not create destination file!", from, to);
+        
+        bool direct(false);
+#ifdef O_DIRECT
+        if(options.direct_io && (static_cast<std::uintmax_t>(st.st_size) >= options.direct_io_threshold))
+        {
+            direct = ((fcntl(in.fd, F_SETFL, (fcntl(in.fd, F_GETFL) | O_DIRECT)) == 0) && 
+                    (fcntl(out.fd, F_SETFL, (fcntl(out.fd, F_GETFL) | O_DIRECT)) == 0));
+            if(!direct)
+            {
+                clear_direct(in.fd);
+                clear_direct(out.fd);
+            }
+        }
+#endif
+        
+        if(options.drop_cache && !direct) posix_fadvise(in.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        
+        std::size_t size(std::max<std::size_t>(options.buffer_size, alignment));
+        size = (((size + alignment) - 1) / alignment) * alignment;
+        std::unique_ptr<char, void (*)(void*)> buffer(static_cast<char*>(aligned_alloc(alignment, size)), &free);
+        if(!buffer) throw std::bad_alloc();
+        
+        //only bother looking for holes if the file occupies less space than its length:
+        bool sparse(options.preserve_sparse && ((st.st_blocks * 512) < st.st_size));
+        
+        const bool parallel((options.parallel_threshold != 0) && (options.parallel_streams > 1) && !sparse && 
+                (static_cast<std::uintmax_t>(st.st_size) >= options.parallel_threshold));
+        std::uint64_t parallel_digest(0);
+        
+        off_t offset(0), flushed(0), pos(0);
+        if(parallel)
+        {
+            offset = static_cast<off_t>(copy_ranges(from, to, in.fd, out.fd, static_cast<std::uintmax_t>(st.st_size), 
+                    options, direct, checksum, parallel_digest));
+            flushed = offset;
+        }
+        while(!parallel && (!sparse || (pos < st.st_size)))
+        {
+            //the extent to copy next.  -1 as its end means "until end of file":
+            off_t begin(pos), end(-1);
+            if(sparse)
+            {
+                begin = lseek(in.fd, pos, SEEK_DATA);
+                if((begin == -1) && (errno == ENXIO))
+                {
+                    if(checksum) digest_zeros(crc, static_cast<std::uintmax_t>(st.st_size - pos));
+                    break;
+                }
+                if(begin == -1)
+                {
+                    //no SEEK_DATA on this filesystem; copy the rest in full:
+                    sparse = false;
+                    begin = pos;
+                }
+                else
+                {
+                    end = lseek(in.fd, begin, SEEK_HOLE);
+                    if(end == -1) end = st.st_size;
+                }
+                if((lseek(in.fd, begin, SEEK_SET) == -1) || (lseek(out.fd, begin, SEEK_SET) == -1))
+                {
+                    int e(errno);
+                    unlink(to.c_str());
+                    errno = e;
+                    throw_errno("Can not seek!", from, to);
+                }
+                if(checksum) digest_zeros(crc, static_cast<std::uintmax_t>(begin - pos));
+            }
+            offset = begin;
+            
+            while((end == -1) || (offset < end))
+            {
+                std::size_t want(size);
+                if((end != -1) && (static_cast<off_t>(want) > (end - offset))) want = static_cast<std::size_t>(end - offset);
+                
+                if(options.scheduler) options.scheduler->acquire_bytes(want);
+                const std::chrono::steady_clock::time_point started(std::chrono::steady_clock::now());
+                ssize_t n(::read(in.fd, buffer.get(), want));
+                if((n != -1) && options.scheduler) options.scheduler->report(std::chrono::steady_clock::now() - started);
+                if((n == -1) && direct && (errno == EINVAL))
+                {
+                    //the filesystem accepted O_DIRECT, but can not actually do it:
+                    clear_direct(in.fd);
+                    clear_direct(out.fd);
+                    direct = false;
+                    continue;
+                }
+                if(n == -1)
+                {
+                    if(errno == EINTR) continue;
+                    int e(errno);
+                    unlink(to.c_str());
+                    errno = e;
+                    throw_errno("Can not read source file!", from, to);
+                }
+                if(n == 0) break;
+                if(checksum) crc.process_bytes(buffer.get(), static_cast<std::size_t>(n));
+                
+                //once a transfer is not a whole number of blocks, the offsets are no longer aligned:
+                if(direct && ((static_cast<std::size_t>(n) % alignment) != 0))
+                {
+                    clear_direct(in.fd);
+                    clear_direct(out.fd);
+                    direct = false;
+                }
+                std::size_t written(write_all(out.fd, buffer.get(), static_cast<std::size_t>(n)));
+                if((written < static_cast<std::size_t>(n)) && direct && (errno == EINVAL))
+                {
+                    clear_direct(in.fd);
+                    clear_direct(out.fd);
+                    direct = false;
+                    written += write_all(out.fd, (buffer.get() + written), (static_cast<std::size_t>(n) - written));
+                }
+                if(written < static_cast<std::size_t>(n))
+                {
+                    int e(errno);
+                    unlink(to.c_str());
+                    errno = e;
+                    throw_errno("Can not write destination file!", from, to);
+                }
+                
+                if(options.drop_cache && !direct)
+                {
+                    posix_fadvise(in.fd, offset, n, POSIX_FADV_DONTNEED);
+#ifdef SYNC_FILE_RANGE_WRITE
+                    /* Start write-back of this chunk, and wait for the previous one
+                     * so its pages are clean and can actually be dropped. */
+                    sync_file_range(out.fd, offset, n, SYNC_FILE_RANGE_WRITE);
+                    if(offset > flushed)
+                    {
+                        sync_file_range(out.fd, flushed, (offset - flushed), 
+                                (SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER));
+                        posix_fadvise(out.fd, flushed, (offset - flushed), POSIX_FADV_DONTNEED);
+                        flushed = offset;
+                    }
+#endif
+                }
+                offset += n;
+            }
+            if(!sparse) break;
+            pos = end;
+        }
+        
+        if(options.drop_cache && !direct && (offset > flushed))
+        {
+            fdatasync(out.fd);
+            posix_fadvise(out.fd, flushed, (offset - flushed), POSIX_FADV_DONTNEED);
+        }
+        
+        //a trailing hole is never written, so extend the file to its full length:
+        if(options.preserve_sparse && (ftruncate(out.fd, st.st_size) == -1))
+        {
+            int e(errno);
+            unlink(to.c_str());
+            errno = e;
+            throw_errno("Can not set destination file size!", from, to);
+        }
+        fchmod(out.fd, (st.st_mode & 07777));
+        
+        //a write error can be deferred until the data reaches the disk:
+        if((options.verify != filesystem::copy_options::no_verify) && (fdatasync(out.fd) == -1))
+        {
+            int e(errno);
+            unlink(to.c_str());
+            errno = e;
+            throw_errno("Can not write destination file!", from, to);
+        }
+        
+        result.digest = (parallel ? parallel_digest : crc.checksum());
+        result.size = static_cast<std::uintmax_t>(options.preserve_sparse ? st.st_size : offset);
+        if(options.preserve_hardlinks && (st.st_nlink > 1)) links[key] = result;
+        return result;
+    }
+    
+    /**
+     * @brief Reads a copied file back from the disk, and checks it against
+     * the checksum taken while it was copied.
+     * @param from The source file, for error messages.
+     * @param f The copy.  Its data must already have been synced.
+     * @param buffer_size How much to read at once.
+     * @param scheduler Paces the reads, if set.
+     */
+    inline void read_back(const path& from, const copied_file& f, const std::size_t& buffer_size, 
+            const std::shared_ptr<filesystem::io_scheduler>& scheduler)
+    {
+        using boost::filesystem::filesystem_error;
+        using boost::system::error_code;
+        using boost::system::system_category;
+        
+        scoped_fd in(::open(f.dest.c_str(), (O_RDONLY | O_CLOEXEC)));
+        if(in.fd == -1) throw_errno("Can not open destination file!", from, f.dest);
+        
+        //the pages are clean after the sync, so this makes us read what is on the disk:
+        posix_fadvise(in.fd, 0, 0, POSIX_FADV_DONTNEED);
+        posix_fadvise(in.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        
+        crc64 crc;
+        std::uintmax_t total(0);
+        std::vector<char> buffer(std::max<std::size_t>(buffer_size, 4096));
+        if(scheduler) scheduler->apply_priority();
+        while(true)
+        {
+            if(scheduler) scheduler->acquire_bytes(buffer.size());
+            const std::chrono::steady_clock::time_point started(std::chrono::steady_clock::now());
+            ssize_t n(::read(in.fd, buffer.data(), buffer.size()));
+            if(scheduler) scheduler->report(std::chrono::steady_clock::now() - started);
+            if(n == -1)
+            {
+                if(errno == EINTR) continue;
+                throw_errno("Can not read destination file!", from, f.dest);
+            }
+            if(n == 0) break;
+            crc.process_bytes(buffer.data(), static_cast<std::size_t>(n));
+            total += static_cast<std::uintmax_t>(n);
+        }
+        posix_fadvise(in.fd, 0, 0, POSIX_FADV_DONTNEED);
+        
+        if((total != f.size) || (crc.checksum() != f.digest))
+        {
+            throw filesystem_error("Verification failed!", from, f.dest, error_code(EIO, system_category()));
+        }
+    }
+    
+    /**
+     * @brief Escapes backslashes and newlines so a path fits on one manifest line.
+     */
+    inline std::string escape_path(const std::string& s)
+    {
+        std::string e;
+        e.reserve(s.size());
+        for(std::string::const_iterator it(s.begin()); it != s.end(); ++it)
+        {
+            if(*it == '\\') e += "\\\\";
+            else if(*it == '\n') e += "\\n";
+            else e += *it;
+        }
+        return e;
+    }
+    
+    inline std::string unescape_path(const std::string& e)
+    {
+        std::string s;
+        s.reserve(e.size());
+        for(std::string::const_iterator it(e.begin()); it != e.end(); ++it)
+        {
+            if((*it == '\\') && ((it + 1) != e.end()))
+            {
+                ++it;
+                s += ((*it == 'n') ? '\n' : *it);
+            }
+            else s += *it;
+        }
+        return s;
+    }
+    
+    /**
+     * @brief Copies a tree that has already been copied, as it is.  Links in it
+     * are copied as links.
+     * @param from The earlier copy.
+     * @param to Where to copy it to.  Must not exist yet.
+     */
+    inline void copy_copied_tree(const path& from, const path& to)
+    {
+        using boost::filesystem::recursive_directory_iterator;
+        
+        boost::filesystem::copy_directory(from, to);
+        for(recursive_directory_iterator it(from); it != recursive_directory_iterator(); ++it)
+        {
+            const path target(to / split(from, it->path()).second);
+            const boost::filesystem::file_status st(it->symlink_status());
+            if(boost::filesystem::is_symlink(st)) boost::filesystem::copy_symlink(it->path(), target);
+            else if(boost::filesystem::is_directory(st)) boost::filesystem::copy_directory(it->path(), target);
+            else boost::filesystem::copy_file(it->path(), target);
+        }
+    }
+    
     /**
      * @brief Copies a single file or folder into "to".  The biggest thing this
      * function does is it makes sure that the directory tree is constructed within 
      * the destination folder.
      * @param from The root folder that the file or folder is being copied from.
-     * @param subpath The actual path of the file or folder to copy.
+     * @param entry The file or folder to copy.
      * @param to the destination folder.
+     * @param options How regular files are copied.
+     * @param links The files copied so far that have more than one link.
+     * @param directories With follow, the directories copied so far.
+     * @param result Set to the copy if a regular file was copied.
+     * @param follow If true, symbolic links are copied as what they point to.
+     * A directory reached a second time is not read again by the traversal, 
+     * so a link to it is copied as a link, and the directory itself as a copy 
+     * of its first copy.
+     * @return true if a regular file was copied.
      */
-    inline void copy_path(const path& from, const path& subpath, const path& to)
+    inline bool copy_path(const path& from, const directory_entry& entry, const path& to, 
+            const filesystem::copy_options& options, link_map& links, directory_map& directories, 
+            copied_file& result, const bool& follow)
     {
         using boost::filesystem::is_directory;
         using boost::filesystem::is_regular_file;
-        using boost::filesystem::is_symlink;
         using boost::filesystem::copy;
+        using boost::filesystem::copy_directory;
         using boost::filesystem::exists;
         
-        path newdest(to / split(from.parent_path(), subpath).second);
+        const path& subpath(entry.path());
+        path relative(split(from.parent_path(), subpath).second), newdest(to / relative);
+        
+        copy_directories(from, subpath.parent_path(), to);
+        if(is_directory(newdest.parent_path()) && !exists(newdest))
+        {
+            //a dangling link is copied as a link either way:
+            boost::filesystem::file_status st(entry.symlink_status());
+            if(follow && boost::filesystem::is_symlink(st) && boost::filesystem::exists(entry.status())) st = entry.status();
+            
+            //boost's copy() would also copy a directory's contents, bypassing the options:
+            if(is_directory(st))
+            {
+                struct stat s;
+                if(follow && (::stat(subpath.c_str(), &s) == 0))
+                {
+                    std::pair<directory_map::iterator, bool> first(directories.insert(
+                            std::make_pair(std::make_pair(s.st_dev, s.st_ino), newdest)));
+                    if(!first.second)
+                    {
+                        if(boost::filesystem::is_symlink(entry.symlink_status())) boost::filesystem::copy_symlink(subpath, newdest);
+                        else copy_copied_tree(first.first->second, newdest);
+                        return false;
+                    }
+                }
+                copy_directory(subpath, newdest);
+            }
+            else if(is_regular_file(st))
+            {
+                const filesystem::io_priority_scope priority(options.scheduler);
+                result = copy_file_data(subpath, newdest, options, links);
+                result.relative = relative;
+                return true;
+            }
+            else if(follow && boost::filesystem::is_symlink(st)) boost::filesystem::copy_symlink(subpath, newdest);
+            else copy(subpath, newdest);
+        }
+        return false;
+    }
+    
+    
+}
+
+/* regular_iterator member functions: */
+namespace filesystem
+{
+    regular_iterator::regular_iterator() : 
+            beg_path(),
+            it()
+    {
+    }
+    
+    regular_iterator::regular_iterator(const path& s) : 
+            beg_path(s),
+            it(s)
+    {
+    }
+    
+    regular_iterator::regular_iterator(const regular_iterator& i) : 
+            beg_path(i.beg_path),
+            it(i.it)
+    {
+    }
+    
+    regular_iterator::~regular_iterator()
+    {
+    }
+    
+    regular_iterator& regular_iterator::operator=(const regular_iterator& i)
+    {
+        if(this != &i)
+        {
+            this->it = i.it;
+            this->beg_path = i.beg_path;
+        }
+        return *this;
+    }
+    
+    bool regular_iterator::operator!=(const regular_iterator& i) const
+    {
+        return (this->it != i.it);
+    }
+    
+    bool regular_iterator::operator==(const regular_iterator& i) const
+    {
+        return (this->it == i.it);
+    }
+    
+    directory_entry& regular_iterator::operator*()
+    {
+        return *(this->it);
+    }
+    
+    directory_entry* regular_iterator::operator->()
+    {
+        return &(*(this->it));
+    }
+    
+    void regular_iterator::swap(regular_iterator& i)
+    {
+        regular_iterator tempit(i);
+        i = (*this);
+        (*this) = tempit;
+    }
+    
+    regular_iterator& regular_iterator::operator++()
+    {
+        using boost::filesystem::is_directory;
+        using boost::filesystem::is_symlink;
+        
+        if(this->end()) return *this;
+        ++(this->it);
+        return *this;
+    }
+    
+    regular_iterator regular_iterator::operator++(int)
+    {
+        regular_iterator newit(*this);
+        ++(*this);
+        return newit;
+    }
+    
+    /**
+     * @return true if at end.
+     */
+    bool regular_iterator::end() const
+    {
+        return (this->it == boost::filesystem::directory_iterator());
+    }
+    
+    
+}
+
+/* traversal_options, copy_options and directory_walker member functions: */
+namespace filesystem
+{
+    traversal_options::traversal_options() : 
+            max_open_fds(0),
+            filter(),
+            excluded_names(),
+            excluded_paths(),
+            max_depth(-1),
+            same_filesystem(false),
+            follow_symlinks(false),
+            scheduler()
+    {
+    }
+    
+    copy_options::copy_options() : 
+            buffer_size(1024 * 1024),
+            drop_cache(false),
+            direct_io(false),
+            direct_io_threshold(64 * 1024 * 1024),
+            parallel_threshold(1024 * 1024 * 1024),
+            parallel_streams(std::max(1u, std::min(8u, std::thread::hardware_concurrency()))),
+            preserve_sparse(false),
+            preserve_hardlinks(false),
+            verify(no_verify),
+            manifest(),
+            scheduler()
+    {
+    }
+    
+    struct directory_walker::state
+    {
+        /* One directory on the active path.  "handle" is null while the
+         * directory has been closed to make room for a deeper one, in which
+         * case "position" and "last" are used to find our place again.  Once
+         * a directory has been closed, the names read from it are kept as 
+         * well ("recorded"), in case the telldir() cookie is no good after 
+         * re-opening; directories never closed keep none. */
+        struct level
+        {
+            path dir;
+            DIR* handle;
+            long position;
+            std::string last;
+            std::unordered_set<std::string> seen;
+            bool recorded;
+            bool rewound;
+            dev_t device;
+            ino_t inode;
+        };
+        
+        explicit state(const traversal_options& o) : 
+                options(o),
+                stack(),
+                open_count(0),
+                entry(),
+                meta(),
+                descend(false),
+                device(0),
+                visited(),
+                priority(o.scheduler)
+        {
+        }
+        
+        ~state()
+        {
+            while(!this->stack.empty()) this->pop();
+        }
+        
+        void close(level& l)
+        {
+            if(l.handle != nullptr)
+            {
+                closedir(l.handle);
+                l.handle = nullptr;
+                --(this->open_count);
+            }
+        }
+        
+        void pop()
+        {
+            this->close(this->stack.back());
+            this->stack.pop_back();
+        }
+        
+        /**
+         * @brief Closes the shallowest open directories until there is room
+         * for one more handle.
+         */
+        void make_room()
+        {
+            if(this->options.max_open_fds == 0) return;
+            for(std::size_t x(0); ((x < this->stack.size()) && 
+                    (this->open_count >= this->options.max_open_fds)); ++x)
+            {
+                if(this->stack[x].handle == nullptr) continue;
+                this->record(this->stack[x]);
+                this->close(this->stack[x]);
+            }
+        }
+        
+        /**
+         * @brief Before a directory is first closed, notes the names read
+         * from it so far, by reading it again up to the last one.  From then
+         * on read() adds each name it reads.
+         */
+        void record(level& l)
+        {
+            if(l.recorded) return;
+            l.recorded = true;
+            if(l.last.empty()) return;
+            
+            rewinddir(l.handle);
+            struct dirent* d(nullptr);
+            while((d = readdir(l.handle)) != nullptr)
+            {
+                if(!strcmp(d->d_name, ".") || !strcmp(d->d_name, "..")) continue;
+                l.seen.insert(d->d_name);
+                if(l.last == d->d_name) break;
+            }
+        }
+        
+        /**
+         * @return The flags every directory is opened with.
+         */
+        int open_flags() const
+        {
+            return (O_RDONLY | O_DIRECTORY | O_CLOEXEC | (this->options.follow_symlinks ? 0 : O_NOFOLLOW));
+        }
+        
+        /**
+         * @brief Opens the directory at stack[index] again, one name at a time
+         * from its deepest open ancestor (or the root), with the same flags
+         * push() used, so a directory replaced by a link is not followed.
+         * @return The descriptor, or -1.
+         */
+        int open_level(const std::size_t& index) const
+        {
+            std::size_t start(index);
+            while((start > 0) && (this->stack[start - 1].handle == nullptr)) --start;
+            
+            int fd(-1);
+            if(start == 0) fd = ::open(this->stack[0].dir.c_str(), this->open_flags());
+            else fd = openat(dirfd(this->stack[start - 1].handle), this->stack[start].dir.filename().c_str(), this->open_flags());
+            for(std::size_t x(start + 1); ((x <= index) && (fd != -1)); ++x)
+            {
+                const int next(openat(fd, this->stack[x].dir.filename().c_str(), this->open_flags()));
+                int e(errno);
+                ::close(fd);
+                errno = e;
+                fd = next;
+            }
+            return fd;
+        }
+        
+        /**
+         * @brief Re-opens a directory that was closed by make_room(), and
+         * positions it just after the last entry that was read from it.  If
+         * the telldir() cookie does not lead back there, the directory is 
+         * read again from the start, skipping the names already seen.
+         * @return false, with errno set, if the directory can not be 
+         * re-opened (ENOENT if it is gone) or is no longer the one that was
+         * closed (ESTALE).
+         */
+        bool reopen(level& l)
+        {
+            this->make_room();
+            if(this->options.scheduler) this->options.scheduler->acquire_ops();
+            const int fd(this->open_level(static_cast<std::size_t>(&l - this->stack.data())));
+            if(fd == -1) return false;
+            
+            struct stat st;
+            if((fstat(fd, &st) == -1) || ((l.inode != 0) && ((st.st_dev != l.device) || (st.st_ino != l.inode))))
+            {
+                ::close(fd);
+                errno = ESTALE;
+                return false;
+            }
+            l.handle = fdopendir(fd);
+            if(l.handle == nullptr)
+            {
+                int e(errno);
+                ::close(fd);
+                errno = e;
+                return false;
+            }
+            ++(this->open_count);
+            if(l.last.empty()) return true;
+            
+            //the telldir() cookie is usually good across re-opens:
+            seekdir(l.handle, l.position);
+            struct dirent* d(readdir(l.handle));
+            if((d != nullptr) && (l.last == d->d_name)) return true;
+            
+            rewinddir(l.handle);
+            l.rewound = true;
+            return true;
+        }
+        
+        /**
+         * @brief Opens a directory and pushes it onto the active path.
+         * @return false if the directory could not be opened.
+         */
+        bool push(const path& p)
+        {
+            this->make_room();
+            
+            if(this->options.scheduler) this->options.scheduler->acquire_ops();
+            const std::chrono::steady_clock::time_point started(std::chrono::steady_clock::now());
+            int fd(-1);
+            const int flags(this->open_flags());
+            if(this->stack.empty()) fd = ::open(p.c_str(), flags);
+            else if(this->stack.back().handle != nullptr)
+            {
+                fd = openat(dirfd(this->stack.back().handle), p.filename().c_str(), flags);
+            }
+            else
+            {
+                //the cap closed the parent; it is found again a name at a time, never by the whole path:
+                const level& parent(this->stack.back());
+                const int at(this->open_level(this->stack.size() - 1));
+                struct stat st;
+                if((at != -1) && (fstat(at, &st) == 0) && 
+                        ((parent.inode == 0) || ((st.st_dev == parent.device) && (st.st_ino == parent.inode))))
+                {
+                    fd = openat(at, p.filename().c_str(), flags);
+                }
+                if(at != -1) ::close(at);
+            }
+            if(this->options.scheduler) this->options.scheduler->report(std::chrono::steady_clock::now() - started);
+            if(fd == -1) return false;
+            
+            //the device and inode are also needed to check a re-opened directory:
+            struct stat st;
+            st.st_dev = this->device;
+            st.st_ino = 0;
+            if(this->options.same_filesystem || this->options.follow_symlinks || (this->options.max_open_fds != 0))
+            {
+                if(fstat(fd, &st) == -1)
+                {
+                    st.st_dev = this->device;
+                    st.st_ino = 0;
+                }
+                if(this->options.same_filesystem)
+                {
+                    if(this->stack.empty()) this->device = st.st_dev;
+                    else if(st.st_dev != this->device)
+                    {
+                        ::close(fd);
+                        return false;
+                    }
+                }
+                
+                //a directory we have been in before, through another link or a cycle:
+                if(this->options.follow_symlinks && (st.st_ino != 0) && 
+                        !this->visited.insert(std::make_pair(st.st_dev, st.st_ino)).second)
+                {
+                    ::close(fd);
+                    return false;
+                }
+            }
+            
+            DIR* handle(fdopendir(fd));
+            if(handle == nullptr)
+            {
+                ::close(fd);
+                return false;
+            }
+            ++(this->open_count);
+            this->stack.push_back(level{p, handle, 0, std::string(), std::unordered_set<std::string>(), false, false, 
+                    st.st_dev, st.st_ino});
+            return true;
+        }
+        
+        /**
+         * @brief Reads the next entry of the deepest directory.
+         * @return false once the directory is exhausted.
+         */
+        bool read(level& l)
+        {
+            struct dirent* d(nullptr);
+            long pos(0);
+            do
+            {
+                pos = telldir(l.handle);
+                d = readdir(l.handle);
+            }while((d != nullptr) && (!strcmp(d->d_name, ".") || !strcmp(d->d_name, "..") || 
+                    (l.rewound && (l.seen.count(d->d_name) > 0))));
+            if(d == nullptr) return false;
+            
+            l.position = pos;
+            l.last = d->d_name;
+            
+            //only needed once this directory has been closed and re-opened:
+            if(l.recorded) l.seen.insert(l.last);
+            
+            using boost::filesystem::file_status;
+            using boost::filesystem::file_type;
+            
+            this->meta = file_metadata();
+            file_type t(boost::filesystem::type_unknown);
+            switch(d->d_type)
+            {
+                case DT_REG: t = boost::filesystem::regular_file; break;
+                case DT_DIR: t = boost::filesystem::directory_file; break;
+                case DT_LNK: t = boost::filesystem::symlink_file; break;
+                case DT_BLK: t = boost::filesystem::block_file; break;
+                case DT_CHR: t = boost::filesystem::character_file; break;
+                case DT_FIFO: t = boost::filesystem::fifo_file; break;
+                case DT_SOCK: t = boost::filesystem::socket_file; break;
+                default:
+                {
+                    //no d_type from this filesystem; a full stat costs the same as a partial one:
+                    if(this->options.scheduler) this->options.scheduler->acquire_ops();
+                    if(stat_entry(dirfd(l.handle), d->d_name, this->meta)) t = this->meta.type;
+                }
+                break;
+            }
+            this->meta.type = t;
+            this->meta.valid |= file_metadata::type_field;
+            
+            if(t == boost::filesystem::symlink_file)
+            {
+                this->entry.assign(l.dir / l.last, file_status(), file_status(t));
+            }
+            else
+            {
+                this->entry.assign(l.dir / l.last, file_status(t), file_status(t));
+            }
+            this->descend = (t == boost::filesystem::directory_file);
+            if((t == boost::filesystem::symlink_file) && this->options.follow_symlinks)
+            {
+                struct stat st;
+                if(this->options.scheduler) this->options.scheduler->acquire_ops();
+                this->descend = ((fstatat(dirfd(l.handle), d->d_name, &st, 0) == 0) && S_ISDIR(st.st_mode));
+            }
+            return true;
+        }
+        
+        /**
+         * @brief Fills in metadata fields of the current entry.
+         */
+        void load(file_metadata& md, const unsigned int& fields)
+        {
+            const level& top(this->stack.back());
+            if(this->options.scheduler) this->options.scheduler->acquire_ops();
+            if(top.handle != nullptr) stat_entry(dirfd(top.handle), top.last.c_str(), md, fields);
+            else stat_entry(AT_FDCWD, this->entry.path().c_str(), md, fields);
+        }
+        
+        /**
+         * @return true if the current entry is excluded by name or path.
+         */
+        bool excluded() const
+        {
+            if(!this->options.excluded_names.empty() && 
+                    (this->options.excluded_names.count(this->stack.back().last) > 0)) return true;
+            return (!this->options.excluded_paths.empty() && 
+                    (this->options.excluded_paths.count(this->entry.path().string()) > 0));
+        }
+        
+        /**
+         * @return true if the current entry passes the filter.
+         */
+        bool accept()
+        {
+            if(this->options.filter.accepts_all()) return true;
+            return this->options.filter.matches(this->stack.back().last, this->meta, 
+                    [this](file_metadata& md, const unsigned int& fields)
+                    {
+                        this->load(md, fields);
+                    });
+        }
+        
+        /**
+         * @brief Moves to the next entry, descending into the current
+         * one if it is a directory.
+         * @return false when the traversal is finished.
+         */
+        bool advance()
+        {
+            while(true)
+            {
+                if(this->descend)
+                {
+                    this->descend = false;
+                    this->push(this->entry.path());
+                }
+                if(this->stack.empty()) return false;
+                
+                level& top(this->stack.back());
+                if((top.handle == nullptr) && !this->reopen(top))
+                {
+                    //deleted, along with whatever was left to read in it:
+                    if(errno == ENOENT)
+                    {
+                        this->pop();
+                        continue;
+                    }
+                    
+                    //the rest of the directory can not be read; stopping here beats skipping it quietly:
+                    using boost::filesystem::filesystem_error;
+                    using boost::system::error_code;
+                    using boost::system::system_category;
+                    
+                    error_code ec(errno, system_category());
+                    const path dir(top.dir);
+                    this->pop();
+                    throw filesystem_error("Can not re-open directory!", dir, ec);
+                }
+                if(!this->read(top))
+                {
+                    this->pop();
+                    continue;
+                }
+                if(this->excluded())
+                {
+                    this->descend = false;
+                    continue;
+                }
+                if((this->options.max_depth >= 0) && 
+                        (static_cast<int>(this->stack.size()) > this->options.max_depth)) this->descend = false;
+                if(this->accept()) return true;
+            }
+        }
+        
+        traversal_options options;
+        std::vector<level> stack;
+        std::size_t open_count;
+        directory_entry entry;
+        file_metadata meta;
+        bool descend;
+        dev_t device;
         
-        copy_directories(from, subpath.parent_path(), to);
-        if(is_directory(newdest.parent_path()) && 
-                !exists(newdest)) copy(subpath, newdest);
-    }
+        //with follow_symlinks, every directory opened so far:
+        std::unordered_set<std::pair<dev_t, ino_t>, inode_hash> visited;
+        
+        //the scheduler's priority, kept by the thread walking until the walk ends or moves:
+        io_priority_hold priority;
+    };
     
+    directory_walker::directory_walker() : 
+            impl()
+    {
+    }
     
-}
-
-/* regular_iterator member functions: */
-namespace filesystem
-{
-    regular_iterator::regular_iterator() : 
-            beg_path(),
-            it()
+    /**
+     * @brief Constructs a walker positioned at the first entry of p.
+     * @param p The root directory.
+     * @param o The traversal settings.
+     */
+    directory_walker::directory_walker(const path& p, const traversal_options& o) : 
+            impl(new state(o))
     {
+        using boost::filesystem::filesystem_error;
+        using boost::system::error_code;
+        using boost::system::system_category;
+        
+        this->impl->priority.enter();
+        if(!this->impl->push(p))
+        {
+            error_code ec(errno, system_category());
+            throw filesystem_error("Can not open directory!", p, ec);
+        }
+        if(!this->impl->advance()) this->impl.reset();
     }
     
-    regular_iterator::regular_iterator(const path& s) : 
-            beg_path(s),
-            it(s)
+    directory_walker::directory_walker(const directory_walker& w) : 
+            impl(w.impl)
     {
     }
     
-    regular_iterator::regular_iterator(const regular_iterator& i) : 
-            beg_path(i.beg_path),
-            it(i.it)
+    directory_walker::~directory_walker()
     {
     }
     
-    regular_iterator::~regular_iterator()
+    directory_walker& directory_walker::operator=(const directory_walker& w)
     {
+        if(this != &w)
+        {
+            this->impl = w.impl;
+        }
+        return *this;
     }
     
-    regular_iterator& regular_iterator::operator=(const regular_iterator& i)
+    directory_walker& directory_walker::operator++()
     {
-        if(this != &i)
+        if(!this->impl) return *this;
+        this->impl->priority.enter();
+        if(!this->impl->advance())
         {
-            this->it = i.it;
-            this->beg_path = i.beg_path;
+            this->impl->priority.release();
+            this->impl.reset();
         }
         return *this;
     }
     
-    bool regular_iterator::operator!=(const regular_iterator& i) const
+    bool directory_walker::operator!=(const directory_walker& w) const
     {
-        return (this->it != i.it);
+        return (this->impl != w.impl);
     }
     
-    bool regular_iterator::operator==(const regular_iterator& i) const
+    bool directory_walker::operator==(const directory_walker& w) const
     {
-        return (this->it == i.it);
+        return (this->impl == w.impl);
     }
     
-    directory_entry& regular_iterator::operator*()
+    directory_entry& directory_walker::operator*() const
     {
-        return *(this->it);
+        return this->impl->entry;
     }
     
-    directory_entry* regular_iterator::operator->()
+    directory_entry* directory_walker::operator->() const
     {
-        return &(*(this->it));
+        return &(this->impl->entry);
     }
     
-    void regular_iterator::swap(regular_iterator& i)
+    /**
+     * @brief Prevents the walker from descending into the current entry.
+     */
+    void directory_walker::no_push()
     {
-        regular_iterator tempit(i);
-        i = (*this);
-        (*this) = tempit;
+        if(this->impl) this->impl->descend = false;
     }
     
-    regular_iterator& regular_iterator::operator++()
+    /**
+     * @return The depth of the current entry.  Entries directly inside
+     * the root are at level 0.
+     */
+    int directory_walker::level() const
     {
-        using boost::filesystem::is_directory;
-        using boost::filesystem::is_symlink;
-        
-        if(this->end()) return *this;
-        ++(this->it);
-        return *this;
+        return (this->impl ? (static_cast<int>(this->impl->stack.size()) - 1) : 0);
     }
     
-    regular_iterator regular_iterator::operator++(int)
+    /**
+     * @return The number of directory handles currently held open.
+     */
+    std::size_t directory_walker::open_handles() const
     {
-        regular_iterator newit(*this);
-        ++(*this);
-        return newit;
+        return (this->impl ? this->impl->open_count : 0);
     }
     
     /**
-     * @return true if at end.
+     * @brief Metadata of the current entry.  Fields gathered while walking
+     * (the type, and anything the filter needed) are reused; only missing
+     * fields are stat'd.
+     * @param fields The file_metadata fields wanted.
      */
-    bool regular_iterator::end() const
+    const file_metadata& directory_walker::metadata(const unsigned int& fields) const
     {
-        return (this->it == boost::filesystem::directory_iterator());
+        if((this->impl->meta.valid & fields) != fields)
+        {
+            this->impl->priority.enter();
+            this->impl->load(this->impl->meta, fields);
+        }
+        return this->impl->meta;
     }
     
     
@@ -196,8 +1545,8 @@ namespace filesystem
     {
     }
     
-    recursive_iterator::recursive_iterator(const boost::filesystem::path& s) : 
-            it(s),
+    recursive_iterator::recursive_iterator(const boost::filesystem::path& s, const traversal_options& o) : 
+            it(s, o),
             beg_path(s)
     {
     }
@@ -249,26 +1598,15 @@ namespace filesystem
         (*this) = tempit;
     }
     
+    /**
+     * Symlinked directories are only descended into with 
+     * traversal_options::follow_symlinks, and then each real directory only 
+     * once.  Directories that can not be opened are skipped.
+     */
     recursive_iterator& recursive_iterator::operator++()
     {
-        using boost::filesystem::is_directory;
-        using boost::filesystem::is_symlink;
-        
         if(this->end()) return *this;
-        
-        try
-        {
-            if(is_directory(this->it->path()) && is_symlink(this->it->path()))
-            {
-                this->it.no_push();
-            }
-            ++(this->it);
-        }
-        catch(...)
-        {
-            this->it.no_push();
-            ++(this->it);
-        }
+        ++(this->it);
         return *this;
     }
     
@@ -284,7 +1622,32 @@ namespace filesystem
      */
     bool recursive_iterator::end() const
     {
-        return (this->it == boost::filesystem::recursive_directory_iterator());
+        return (this->it == directory_walker());
+    }
+    
+    /**
+     * @brief Metadata of the current entry, reusing what the traversal already knows.
+     */
+    const file_metadata& recursive_iterator::metadata(const unsigned int& fields) const
+    {
+        return this->it.metadata(fields);
+    }
+    
+    /**
+     * @brief Prevents the iterator from descending into the current entry.
+     */
+    void recursive_iterator::no_push()
+    {
+        this->it.no_push();
+    }
+    
+    /**
+     * @return The depth of the current entry.  Entries directly inside
+     * the root are at level 0.
+     */
+    int recursive_iterator::level() const
+    {
+        return this->it.level();
     }
     
     
@@ -292,15 +1655,74 @@ namespace filesystem
 
 namespace filesystem
 {
+    /* What a copy has to remember between files.  Shared by copies of the iterator. */
+    struct copy_iterator::state
+    {
+        /* How many read-back verifications may run alongside the copy. */
+        static const std::size_t max_pending = 4;
+        
+        explicit state(const bool& f) : 
+                links(),
+                directories(),
+                manifest(),
+                pending(),
+                follow(f)
+        {
+        }
+        
+        /**
+         * @brief Writes a copied file's line to the manifest, if there is one.
+         */
+        void record(const copied_file& f)
+        {
+            if(!this->manifest.is_open()) return;
+            this->manifest<< std::hex<< std::setw(16)<< std::setfill('0')<< f.digest<< std::dec<< ' '<< 
+                    f.size<< ' '<< escape_path(f.relative.string())<< '\n';
+        }
+        
+        /**
+         * @brief Finishes read-back verifications, rethrowing their errors.
+         * @param all If false, only the ones already done (and enough to get
+         * below max_pending) are waited on.
+         */
+        void collect(const bool& all)
+        {
+            while(!this->pending.empty())
+            {
+                std::future<void>& front(this->pending.front().first);
+                if(!all && (this->pending.size() < max_pending) && 
+                        (front.wait_for(std::chrono::seconds(0)) != std::future_status::ready)) break;
+                
+                copied_file f(this->pending.front().second);
+                std::future<void> done(std::move(front));
+                this->pending.pop_front();
+                done.get();
+                this->record(f);
+            }
+        }
+        
+        link_map links;
+        directory_map directories;
+        std::ofstream manifest;
+        std::deque<std::pair<std::future<void>, copied_file> > pending;
+        
+        //traversal_options::follow_symlinks:
+        bool follow;
+    };
+    
     copy_iterator::copy_iterator() : 
-            recursive_iterator()
+            recursive_iterator(),
+            shared(new state(false))
     {
     }
     
-    copy_iterator::copy_iterator(const path& from, const path& to) : 
-            recursive_iterator(from),
+    copy_iterator::copy_iterator(const path& from, const path& to, const copy_options& o, 
+            const traversal_options& t) : 
+            recursive_iterator(from, t),
             source(from),
-            dest(to)
+            dest(to),
+            options(o),
+            shared(new state(t.follow_symlinks))
     {
         using boost::filesystem::is_directory;
         using boost::filesystem::filesystem_error;
@@ -308,12 +1730,26 @@ namespace filesystem
         
         error_code ec;
         if(is_directory(to / from.filename())) throw filesystem_error("Path exists!", from, to, ec);
+        
+        //the root is the first directory the traversal reads:
+        struct stat st;
+        if(t.follow_symlinks && (::stat(from.c_str(), &st) == 0))
+        {
+            this->shared->directories[std::make_pair(st.st_dev, st.st_ino)] = (to / from.filename());
+        }
+        if(!this->options.manifest.empty())
+        {
+            this->shared->manifest.open(this->options.manifest.string().c_str(), (std::ios::out | std::ios::app));
+            if(!this->shared->manifest.is_open()) throw filesystem_error("Can not open manifest!", this->options.manifest, ec);
+        }
     }
     
     copy_iterator::copy_iterator(const copy_iterator& c) : 
             recursive_iterator(c),
             source(c.source),
-            dest(c.dest)
+            dest(c.dest),
+            options(c.options),
+            shared(c.shared)
     {
     }
     
@@ -328,14 +1764,39 @@ namespace filesystem
             recursive_iterator::operator=(c);
             this->source = c.source;
             this->dest = c.dest;
+            this->options = c.options;
+            this->shared = c.shared;
         }
         return *this;
     }
     
+    /**
+     * Copies the current entry.  With copy_options::verify_read_back, copies
+     * are read back on background threads; a failed verification is thrown
+     * from a later increment, at the latest the one that reaches the end.
+     */
     copy_iterator& copy_iterator::operator++()
     {
-        copy_path(this->source, this->it->path(), this->dest);
+        copied_file f;
+        if(copy_path(this->source, *(this->it), this->dest, this->options, this->shared->links, this->shared->directories, f, 
+                this->shared->follow))
+        {
+            if((this->options.verify == copy_options::verify_read_back) && !f.linked)
+            {
+                const std::size_t buffer_size(this->options.buffer_size);
+                const std::shared_ptr<io_scheduler> scheduler(this->options.scheduler);
+                const path from(this->it->path());
+                this->shared->pending.push_back(std::make_pair(std::async(std::launch::async, 
+                        [from, f, buffer_size, scheduler]()
+                        {
+                            read_back(from, f, buffer_size, scheduler);
+                        }), f));
+            }
+            else this->shared->record(f);
+        }
+        this->shared->collect(false);
         recursive_iterator::operator++();
+        if(this->end()) this->shared->collect(true);
         return *this;
     }
     
@@ -347,6 +1808,293 @@ namespace filesystem
     }
     
     
+}
+
+//prefetch_iterator member functions:
+namespace filesystem
+{
+    struct prefetch_iterator::state
+    {
+        /* One entry as the background thread read it. */
+        struct item
+        {
+            directory_entry entry;
+            file_metadata meta;
+            int level;
+            
+            //entries are numbered from 1 in the order they were read:
+            std::uint64_t number;
+        };
+        
+        state(const recursive_iterator& i, const std::size_t& c, const std::shared_ptr<io_scheduler>& s, 
+                const unsigned int& f) : 
+                ring(c),
+                current(),
+                scheduler(s),
+                skip_level(-1),
+                error(),
+                pruned(0),
+                done(false),
+                stop(false),
+                producer()
+        {
+            this->producer = std::thread(&state::produce, this, i, f);
+        }
+        
+        ~state()
+        {
+            this->stop.store(true, std::memory_order_relaxed);
+            if(this->producer.joinable()) this->producer.join();
+        }
+        
+        /**
+         * @brief Runs on the background thread.  Walks the tree and pushes
+         * every entry into the ring, waiting whenever it is full.  Once the
+         * caller prunes a directory this thread is still inside of, the rest
+         * of it is passed over without opening anything below.
+         */
+        void produce(recursive_iterator it, const unsigned int fields)
+        {
+            try
+            {
+                if(this->scheduler) this->scheduler->apply_priority();
+                
+                //the number of the entry last read at each level, which is the current one's parent at the level above:
+                std::vector<std::uint64_t> above;
+                std::uint64_t number(0), seen_pruned(0);
+                int pruned_level(-1);
+                for(; !it.end(); ++it)
+                {
+                    const int l(it.level());
+                    const std::uint64_t p(this->pruned.load(std::memory_order_acquire));
+                    if(p != seen_pruned)
+                    {
+                        seen_pruned = p;
+                        for(int x(0); ((x < l) && (x < static_cast<int>(above.size()))); ++x)
+                        {
+                            if(above[x] == p) pruned_level = x;
+                        }
+                    }
+                    if(pruned_level >= 0)
+                    {
+                        if(l > pruned_level)
+                        {
+                            it.no_push();
+                            continue;
+                        }
+                        pruned_level = -1;
+                    }
+                    
+                    if(static_cast<int>(above.size()) <= l) above.resize(l + 1);
+                    above[l] = ++number;
+                    item i{*it, it.metadata(fields), l, number};
+                    for(unsigned int x(0); !this->ring.push(std::move(i)); ++x)
+                    {
+                        if(this->stop.load(std::memory_order_relaxed)) return;
+                        backoff(x);
+                    }
+                    if(this->stop.load(std::memory_order_relaxed)) return;
+                }
+            }
+            catch(...)
+            {
+                this->error = std::current_exception();
+            }
+            this->done.store(true, std::memory_order_release);
+        }
+        
+        /**
+         * @brief Spins briefly, then yields, then sleeps.
+         */
+        static void backoff(const unsigned int& x)
+        {
+            if(x < 64) return;
+            if(x < 256) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        
+        /**
+         * @brief Moves to the next entry, passing over what was read ahead
+         * from inside a pruned directory.
+         * @return false once there are no more.
+         */
+        bool next()
+        {
+            while(this->pop())
+            {
+                if((this->skip_level >= 0) && (this->current.level > this->skip_level)) continue;
+                this->skip_level = -1;
+                return true;
+            }
+            return false;
+        }
+        
+        /**
+         * @brief Takes the next entry from the ring.
+         * @return false once the producer has finished and the ring is empty.
+         */
+        bool pop()
+        {
+            for(unsigned int x(0); !this->ring.pop(this->current); ++x)
+            {
+                if(this->done.load(std::memory_order_acquire))
+                {
+                    //anything pushed before "done" was set is visible now:
+                    if(this->ring.pop(this->current)) return true;
+                    if(this->error) std::rethrow_exception(this->error);
+                    return false;
+                }
+                backoff(x);
+            }
+            return true;
+        }
+        
+        /**
+         * @brief Keeps the walk out of the current entry.  Whatever was
+         * already read from inside it is dropped as it comes out of the ring.
+         */
+        void no_push()
+        {
+            this->skip_level = this->current.level;
+            this->pruned.store(this->current.number, std::memory_order_release);
+        }
+        
+        spsc_ring<item> ring;
+        item current;
+        std::shared_ptr<io_scheduler> scheduler;
+        int skip_level;
+        std::exception_ptr error;
+        std::atomic<std::uint64_t> pruned;
+        std::atomic<bool> done, stop;
+        std::thread producer;
+    };
+    
+    prefetch_iterator::prefetch_iterator() : 
+            impl()
+    {
+    }
+    
+    /**
+     * @brief Starts walking p on a background thread.
+     * @param p The root directory.
+     * @param o The traversal settings.
+     * @param c How many entries may be read ahead of the caller.
+     * @param f The file_metadata fields to read ahead with each entry.  Others
+     * are fetched on the caller's thread when metadata() asks for them.
+     */
+    prefetch_iterator::prefetch_iterator(const path& p, const traversal_options& o, const std::size_t& c, 
+            const unsigned int& f) : 
+            impl()
+    {
+        //constructed here so a bad root throws in the caller's thread:
+        recursive_iterator it(p, o);
+        if(it.end()) return;
+        this->impl.reset(new state(it, c, o.scheduler, f));
+        if(!this->impl->next()) this->impl.reset();
+    }
+    
+    prefetch_iterator::prefetch_iterator(const prefetch_iterator& p) : 
+            impl(p.impl)
+    {
+    }
+    
+    prefetch_iterator::~prefetch_iterator()
+    {
+    }
+    
+    prefetch_iterator& prefetch_iterator::operator=(const prefetch_iterator& p)
+    {
+        if(this != &p)
+        {
+            this->impl = p.impl;
+        }
+        return *this;
+    }
+    
+    prefetch_iterator& prefetch_iterator::operator++()
+    {
+        if(this->end()) return *this;
+        if(!this->impl->next()) this->impl.reset();
+        return *this;
+    }
+    
+    prefetch_iterator prefetch_iterator::operator++(int)
+    {
+        prefetch_iterator newit(*this);
+        ++(*this);
+        return newit;
+    }
+    
+    bool prefetch_iterator::operator!=(const prefetch_iterator& p) const
+    {
+        return (this->impl != p.impl);
+    }
+    
+    bool prefetch_iterator::operator==(const prefetch_iterator& p) const
+    {
+        return (this->impl == p.impl);
+    }
+    
+    directory_entry& prefetch_iterator::operator*()
+    {
+        return this->impl->current.entry;
+    }
+    
+    directory_entry* prefetch_iterator::operator->()
+    {
+        return &(this->impl->current.entry);
+    }
+    
+    void prefetch_iterator::swap(prefetch_iterator& p)
+    {
+        prefetch_iterator tempit(p);
+        p = (*this);
+        (*this) = tempit;
+    }
+    
+    /**
+     * @return true if at end.
+     */
+    bool prefetch_iterator::end() const
+    {
+        return !(this->impl);
+    }
+    
+    /**
+     * @return The current entry's metadata, with at least the fields asked
+     * for.  Fields that were not read ahead are stat'ed by path.
+     */
+    const file_metadata& prefetch_iterator::metadata(const unsigned int& fields) const
+    {
+        file_metadata& md(this->impl->current.meta);
+        if((md.valid & fields) != fields)
+        {
+            if(this->impl->scheduler) this->impl->scheduler->acquire_ops();
+            stat_entry(AT_FDCWD, this->impl->current.entry.path().c_str(), md, fields);
+        }
+        return md;
+    }
+    
+    /**
+     * @brief Prevents the iterator from descending into the current entry.
+     * The background thread may already have read some of it; those entries
+     * are skipped, and it stops opening directories below.
+     */
+    void prefetch_iterator::no_push()
+    {
+        this->impl->no_push();
+    }
+    
+    /**
+     * @return The depth of the current entry.  Entries directly inside
+     * the root are at level 0.
+     */
+    int prefetch_iterator::level() const
+    {
+        return this->impl->current.level;
+    }
+    
+    
 }
 
 //glob member functions:
@@ -355,14 +2103,16 @@ namespace filesystem
     glob::glob() : 
             regular_iterator(),
             expression(),
-            exact_match(false)
+            exact_match(false),
+            prefilter()
     {
     }
     
     glob::glob(const glob& g) : 
             regular_iterator(g),
             expression(g.expression),
-            exact_match(g.exact_match)
+            exact_match(g.exact_match),
+            prefilter(g.prefilter)
     {
     }
     
@@ -375,7 +2125,8 @@ namespace filesystem
     glob::glob(const boost::filesystem::path& p, const std::string& r, const bool& e) : 
             regular_iterator(p),
             expression(r, boost::regex::basic),
-            exact_match(e)
+            exact_match(e),
+            prefilter(r, e)
     {
         if(!this->matches()) this->operator++();
     }
@@ -391,6 +2142,7 @@ namespace filesystem
             regular_iterator::operator=(g);
             this->expression = g.expression;
             this->exact_match = g.exact_match;
+            this->prefilter = g.prefilter;
         }
         return *this;
     }
@@ -414,16 +2166,9 @@ namespace filesystem
     
     bool glob::matches() const
     {
-        using boost::regex_match;
-        using boost::regex_search;
-        
         if(this->end()) return false;
-        
-        if(this->exact_match)
-        {
-            return regex_match(this->it->path().string().c_str(), this->expression);
-        }
-        return regex_search(this->it->path().string().c_str(), this->expression);
+        if(!this->prefilter.passes(this->it->path().string())) return false;
+        return path_matches(this->it->path(), this->expression, this->exact_match);
     }
     
     
@@ -435,21 +2180,25 @@ namespace filesystem
     recursive_glob::recursive_glob() : 
             recursive_iterator(),
             expression(),
-            exact_match(false)
+            exact_match(false),
+            prefilter()
     {
     }
     
     recursive_glob::recursive_glob(const recursive_glob& g) : 
             recursive_iterator(g),
             expression(g.expression),
-            exact_match(g.exact_match)
+            exact_match(g.exact_match),
+            prefilter(g.prefilter)
     {
     }
     
-    recursive_glob::recursive_glob(const boost::filesystem::path& p, const std::string& r, const bool& e) : 
-            recursive_iterator(p),
+    recursive_glob::recursive_glob(const boost::filesystem::path& p, const std::string& r, const bool& e, 
+            const traversal_options& o) : 
+            recursive_iterator(p, o),
             expression(r, boost::regex::basic),
-            exact_match(e)
+            exact_match(e),
+            prefilter(r, e)
     {
         if(!this->matches()) this->operator++();
     }
@@ -465,6 +2214,7 @@ namespace filesystem
             recursive_iterator::operator=(r);
             this->expression = r.expression;
             this->exact_match = r.exact_match;
+            this->prefilter = r.prefilter;
         }
         return *this;
     }
@@ -487,19 +2237,55 @@ namespace filesystem
     }
     
     bool recursive_glob::matches() const
+    {
+        if(this->end()) return false;
+        if(!this->prefilter.passes(this->it->path().string())) return false;
+        return path_matches(this->it->path(), this->expression, this->exact_match);
+    }
+    
+    
+}
+
+namespace filesystem
+{
+    /**
+     * @brief The matching glob and recursive_glob use.
+     * @param p The path to test.
+     * @param e The regex to match the path against.
+     * @param exact If true, the whole path must match instead of just part of it.
+     */
+    bool path_matches(const boost::filesystem::path& p, const boost::regex& e, const bool& exact)
     {
         using boost::regex_match;
         using boost::regex_search;
         
-        if(this->end()) return false;
-        
-        if(this->exact_match)
+        if(exact) return regex_match(p.string().c_str(), e);
+        return regex_search(p.string().c_str(), e);
+    }
+    
+    /**
+     * @brief Reads a manifest written by copy_iterator.
+     * @param p The manifest.
+     * @return Each file's checksum and size, keyed by its path relative to the
+     * destination folder.  If a path appears more than once, the last line wins.
+     */
+    std::map<boost::filesystem::path, manifest_entry> read_manifest(const boost::filesystem::path& p)
+    {
+        std::map<path, manifest_entry> entries;
+        std::ifstream in(p.string().c_str());
+        std::string line;
+        while(std::getline(in, line))
         {
-            return regex_match(this->it->path().string().c_str(), this->expression);
+            std::istringstream fields(line);
+            manifest_entry e;
+            std::string name;
+            if(!(fields>> std::hex>> e.digest>> std::dec>> e.size)) continue;
+            fields.get();
+            std::getline(fields, name);
+            entries[path(unescape_path(name))] = e;
         }
-        return regex_search(this->it->path().string().c_str(), this->expression);
+        return entries;
     }
     
     
 }
-
@@ -2,7 +2,16 @@
 #define UTILITY_FILESYSTEM_HPP_INCLUDED
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <string>
+#include <unordered_set>
+
+#include "io_scheduler.hpp"
+#include "name_filter.hpp"
+#include "predicate.hpp"
 
 /** 
  * @author Jonathan Whitlock
@@ -17,7 +26,174 @@ namespace filesystem
     class copy_iterator;
     class glob;
     class recursive_glob;
+    class prefetch_iterator;
+    class directory_walker;
+    struct traversal_options;
+    struct copy_options;
+    struct manifest_entry;
+    
+    
+    /**
+     * @struct traversal_options
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file filesystem.hpp
+     * @brief Settings for the recursive traversal engine.
+     */
+    struct traversal_options
+    {
+        explicit traversal_options();
+        
+        /* The most directory handles a traversal may hold open at once.  When 
+         * the limit is reached, the handles of the shallowest ancestors are closed
+         * and re-opened on the way back up.  0 means no limit. */
+        std::size_t max_open_fds;
+        
+        /* Only entries matching the filter are visited.  Directories that do not
+         * match are still descended into. */
+        predicate filter;
+        
+        /* Entries with one of these file names, or one of these full paths, are
+         * skipped entirely: not visited, and not descended into. */
+        std::unordered_set<std::string> excluded_names;
+        std::unordered_set<std::string> excluded_paths;
+        
+        /* The deepest level visited.  Entries directly inside the root are at 
+         * level 0.  -1 means no limit. */
+        int max_depth;
+        
+        /* If true, mount points are visited but not descended into. */
+        bool same_filesystem;
+        
+        /* If true, symbolic links to directories are descended into.  The links
+         * themselves are still what is visited.  A directory reached again, by
+         * any path, is visited but not descended into again, so cycles end
+         * and each real directory is read once.  (sharded_glob workers each 
+         * remember only the directories they have read.) */
+        bool follow_symlinks;
+        
+        /* If set, directory opens and stats are paced by it, and the thread
+         * walking gets its I/O priority from the first increment until the
+         * walk ends (or moves to another thread, which takes it over). */
+        std::shared_ptr<io_scheduler> scheduler;
+    };
+    
+    /**
+     * @struct copy_options
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file filesystem.hpp
+     * @brief Settings for how copy_iterator copies the contents of regular files.
+     */
+    struct copy_options
+    {
+        explicit copy_options();
+        
+        /* The size of the buffer file data is moved through. */
+        std::size_t buffer_size;
+        
+        /* If true, the kernel is told that files are read sequentially and
+         * that the copied data will not be needed again, so a large copy does
+         * not push everything else out of the page cache. */
+        bool drop_cache;
+        
+        /* If true, files at least direct_io_threshold bytes large are copied
+         * with O_DIRECT, bypassing the page cache entirely.  Falls back to
+         * normal I/O where the filesystem does not support it. */
+        bool direct_io;
+        std::uintmax_t direct_io_threshold;
+        
+        /* Files at least parallel_threshold bytes large are preallocated and 
+         * copied as several ranges at once, by parallel_streams threads.  Sparse 
+         * files whose holes are preserved are always copied in one stream. 0 as 
+         * the threshold turns this off. */
+        std::uintmax_t parallel_threshold;
+        unsigned int parallel_streams;
+        
+        /* If true, holes in sparse files are recreated instead of written out as zeros. */
+        bool preserve_sparse;
+        
+        /* If true, a file with several hard links inside the source tree is
+         * copied once, and its other names become hard links to that copy. */
+        bool preserve_hardlinks;
+        
+        enum verify_mode
+        {
+            no_verify, 
+            
+            //checksum the source as it is read, and make sure every write reached the disk:
+            verify_written,
+            
+            //also read each copy back on a background thread and compare checksums:
+            verify_read_back
+        };
+        verify_mode verify;
+        
+        /* If not empty, a line with the checksum, size and relative path of every
+         * regular file copied is appended to this file.  See read_manifest(). */
+        boost::filesystem::path manifest;
+        
+        /* If set, file data read (including reading copies back) is paced by
+         * it, and the threads reading it get its I/O priority.  Pace the
+         * traversal with traversal_options::scheduler, which may be the same
+         * scheduler. */
+        std::shared_ptr<io_scheduler> scheduler;
+    };
+    
+    /**
+     * @struct manifest_entry
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file filesystem.hpp
+     * @brief A file's line in a copy manifest: its CRC-64 checksum and size.
+     */
+    struct manifest_entry
+    {
+        std::uint64_t digest;
+        std::uintmax_t size;
+    };
     
+    std::map<boost::filesystem::path, manifest_entry> read_manifest(const boost::filesystem::path&);
+    bool path_matches(const boost::filesystem::path&, const boost::regex&, const bool& = false);
+    
+    /**
+     * @class directory_walker
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file filesystem.hpp
+     * @brief A depth-first directory traversal built directly on POSIX
+     * directory streams.  It behaves like boost's recursive_directory_iterator
+     * (copies share their position), but can cap the number of open directory
+     * handles so that the descriptor count stays flat regardless of depth.
+     */
+    class directory_walker
+    {
+    public:
+        explicit directory_walker();
+        directory_walker(const boost::filesystem::path&, const traversal_options& = traversal_options());
+        directory_walker(const directory_walker&);
+        
+        ~directory_walker();
+        
+        directory_walker& operator=(const directory_walker&);
+        directory_walker& operator++();
+        
+        bool operator!=(const directory_walker&) const;
+        bool operator==(const directory_walker&) const;
+        
+        boost::filesystem::directory_entry& operator*() const;
+        boost::filesystem::directory_entry* operator->() const;
+        
+        void no_push();
+        int level() const;
+        std::size_t open_handles() const;
+        const file_metadata& metadata(const unsigned int& = file_metadata::all_fields) const;
+        
+    private:
+        struct state;
+        
+        std::shared_ptr<state> impl;
+    };
     
     /**
      * @class regular_iterator
@@ -60,13 +236,13 @@ namespace filesystem
      * @date 02/16/2016
      * @file filesystem.hpp
      * @brief A recursive filesystem iterator wrapper for the
-     * boost recursive_directory_iterator.
+     * directory_walker.
      */
     class recursive_iterator
     {
     public:
         explicit recursive_iterator();
-        recursive_iterator(const boost::filesystem::path&);
+        recursive_iterator(const boost::filesystem::path&, const traversal_options& = traversal_options());
         recursive_iterator(const recursive_iterator&);
         
         virtual ~recursive_iterator();
@@ -83,9 +259,13 @@ namespace filesystem
         void swap(recursive_iterator&);
         
         bool end() const;
+        const file_metadata& metadata(const unsigned int& = file_metadata::all_fields) const;
+        
+        void no_push();
+        int level() const;
         
     protected:
-        boost::filesystem::recursive_directory_iterator it;
+        directory_walker it;
         boost::filesystem::path beg_path;
         
     };
@@ -101,7 +281,8 @@ namespace filesystem
     {
     public:
         explicit copy_iterator();
-        copy_iterator(const boost::filesystem::path&, const boost::filesystem::path&);
+        copy_iterator(const boost::filesystem::path&, const boost::filesystem::path&, const copy_options& = copy_options(), 
+                const traversal_options& = traversal_options());
         copy_iterator(const copy_iterator&);
         virtual ~copy_iterator();
         
@@ -110,7 +291,55 @@ namespace filesystem
         copy_iterator operator++(int);
         
     private:
+        struct state;
+        
         boost::filesystem::path source, dest;
+        copy_options options;
+        std::shared_ptr<state> shared;
+    };
+    
+    /**
+     * @class prefetch_iterator
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file filesystem.hpp
+     * @brief A recursive iterator that reads ahead.  A background thread runs a
+     * recursive_iterator and hands its entries over through a lock-free ring
+     * buffer, so directory reads overlap with whatever the caller does with
+     * each entry.  Entries arrive in the same order recursive_iterator
+     * would produce them.  Copies share their position.
+     */
+    class prefetch_iterator
+    {
+    public:
+        explicit prefetch_iterator();
+        prefetch_iterator(const boost::filesystem::path&, const traversal_options& = traversal_options(), 
+                const std::size_t& = 1024, const unsigned int& = 0);
+        prefetch_iterator(const prefetch_iterator&);
+        
+        virtual ~prefetch_iterator();
+        
+        virtual prefetch_iterator& operator=(const prefetch_iterator&);
+        virtual prefetch_iterator& operator++();
+        prefetch_iterator operator++(int);
+        
+        bool operator!=(const prefetch_iterator&) const;
+        bool operator==(const prefetch_iterator&) const;
+        
+        boost::filesystem::directory_entry& operator*();
+        boost::filesystem::directory_entry* operator->();
+        void swap(prefetch_iterator&);
+        
+        bool end() const;
+        const file_metadata& metadata(const unsigned int& = file_metadata::all_fields) const;
+        
+        void no_push();
+        int level() const;
+        
+    private:
+        struct state;
+        
+        std::shared_ptr<state> impl;
     };
     
     /**
@@ -139,6 +368,7 @@ namespace filesystem
     
         boost::regex expression;
         bool exact_match;
+        name_filter prefilter;
         
     };
     
@@ -156,7 +386,8 @@ namespace filesystem
     public:
         explicit recursive_glob();
         recursive_glob(const recursive_glob&);
-        recursive_glob(const boost::filesystem::path&, const std::string& = "", const bool& = false);
+        recursive_glob(const boost::filesystem::path&, const std::string& = "", const bool& = false, 
+                const traversal_options& = traversal_options());
         virtual ~recursive_glob();
         
         virtual recursive_glob& operator=(const recursive_glob&);
@@ -168,6 +399,7 @@ namespace filesystem
     
         boost::regex expression;
         bool exact_match;
+        name_filter prefilter;
         
     };
     
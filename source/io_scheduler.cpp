@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "io_scheduler.hpp"
+
+namespace
+{
+    /* From linux/ioprio.h, which is not always installed. */
+    const int ioprio_who_process(1);
+    const int ioprio_class_shift(13);
+    const int ioprio_class_be(2);
+    const int ioprio_class_idle(3);
+    
+    //the priority the innermost io_priority_scope gave this thread, or -1:
+    thread_local int applied_priority(-1);
+    
+    //this thread's id, once asked for:
+    thread_local long thread_id(0);
+    
+    //the longest delay latency back-off adds before one operation:
+    const std::chrono::microseconds max_delay(std::chrono::seconds(1));
+    const std::chrono::microseconds min_delay(100);
+    
+    
+}
+
+namespace filesystem
+{
+    io_limits::io_limits() : 
+            bytes_per_second(0),
+            ops_per_second(0),
+            priority(default_priority),
+            priority_level(4),
+            latency_target(0)
+    {
+    }
+    
+    io_scheduler::io_scheduler(const io_limits& l) : 
+            settings(l),
+            lock(),
+            bytes{static_cast<double>(l.bytes_per_second), std::chrono::steady_clock::now()},
+            ops{static_cast<double>(l.ops_per_second), std::chrono::steady_clock::now()},
+            average_latency(0),
+            delay(0)
+    {
+    }
+    
+    /**
+     * @brief Blocks until "count" bytes of file data may be moved.
+     */
+    void io_scheduler::acquire_bytes(const std::uintmax_t& count)
+    {
+        this->take(this->bytes, static_cast<double>(this->settings.bytes_per_second), static_cast<double>(count));
+    }
+    
+    /**
+     * @brief Blocks until "count" metadata operations may be done.
+     */
+    void io_scheduler::acquire_ops(const std::uintmax_t& count)
+    {
+        this->take(this->ops, static_cast<double>(this->settings.ops_per_second), static_cast<double>(count));
+    }
+    
+    /**
+     * @brief Records how long an operation took, for latency back-off.
+     */
+    void io_scheduler::report(const std::chrono::steady_clock::duration& d)
+    {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        
+        if(this->settings.latency_target.count() == 0) return;
+        
+        std::lock_guard<std::mutex> guard(this->lock);
+        const double latest(static_cast<double>(duration_cast<microseconds>(d).count()));
+        this->average_latency = ((this->average_latency == 0) ? latest : ((0.875 * this->average_latency) + (0.125 * latest)));
+        if(this->average_latency > static_cast<double>(this->settings.latency_target.count()))
+        {
+            this->delay = std::min(max_delay, std::max(min_delay, (this->delay * 2)));
+        }
+        else
+        {
+            this->delay /= 2;
+            if(this->delay < min_delay) this->delay = microseconds(0);
+        }
+    }
+    
+    /**
+     * @brief Gives the calling thread the configured I/O priority for good.
+     * Only threads the library starts, and that end with the job, call
+     * this; anything running on the caller's thread holds an
+     * io_priority_scope instead.
+     */
+    void io_scheduler::apply_priority() const
+    {
+        const int value(this->priority_value());
+        if(value == 0) return;
+#ifdef SYS_ioprio_set
+        //"who" 0 is the calling thread:
+        if(syscall(SYS_ioprio_set, ioprio_who_process, 0, value) == 0) applied_priority = value;
+#endif
+    }
+    
+    /**
+     * @return The ioprio value for the configured priority, or 0 to leave
+     * the priority alone.
+     */
+    int io_scheduler::priority_value() const
+    {
+        switch(this->settings.priority)
+        {
+            case io_limits::best_effort_priority:
+            return ((ioprio_class_be << ioprio_class_shift) | std::max(0, std::min(7, this->settings.priority_level)));
+            
+            case io_limits::idle_priority:
+            return (ioprio_class_idle << ioprio_class_shift);
+            
+            default:
+            return 0;
+        }
+    }
+    
+    const io_limits& io_scheduler::limits() const
+    {
+        return this->settings;
+    }
+    
+    /**
+     * @brief Takes tokens from a bucket, sleeping for as long as it takes to
+     * earn any that are missing, plus the latency back-off.
+     */
+    void io_scheduler::take(bucket& b, const double& rate, const double& count)
+    {
+        using std::chrono::steady_clock;
+        using std::chrono::duration;
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        
+        microseconds wait(0);
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            wait = this->delay;
+            if(rate > 0)
+            {
+                const steady_clock::time_point now(steady_clock::now());
+                b.tokens = std::min(rate, (b.tokens + (rate * duration<double>(now - b.last).count())));
+                b.last = now;
+                b.tokens -= count;
+                if(b.tokens < 0) wait += duration_cast<microseconds>(duration<double>(-b.tokens / rate));
+            }
+        }
+        if(wait.count() > 0) std::this_thread::sleep_for(wait);
+    }
+    
+    
+}
+
+//io_priority_scope member functions:
+namespace filesystem
+{
+    /**
+     * @param s The scheduler whose priority to use.  May be null.
+     */
+    io_priority_scope::io_priority_scope(const std::shared_ptr<io_scheduler>& s) : 
+            previous(-1),
+            outer(applied_priority)
+    {
+        if(!s) return;
+        const int value(s->priority_value());
+        if((value == 0) || (value == applied_priority)) return;
+#if defined(SYS_ioprio_get) && defined(SYS_ioprio_set)
+        const long old(syscall(SYS_ioprio_get, ioprio_who_process, 0));
+        if((old == -1) || (syscall(SYS_ioprio_set, ioprio_who_process, 0, value) == -1)) return;
+        this->previous = static_cast<int>(old);
+        applied_priority = value;
+#endif
+    }
+    
+    io_priority_scope::~io_priority_scope()
+    {
+        if(this->previous == -1) return;
+#ifdef SYS_ioprio_set
+        syscall(SYS_ioprio_set, ioprio_who_process, 0, this->previous);
+#endif
+        applied_priority = this->outer;
+    }
+    
+    
+}
+
+//io_priority_hold member functions:
+namespace filesystem
+{
+    /**
+     * @param s The scheduler whose priority to use.  May be null.
+     */
+    io_priority_hold::io_priority_hold(const std::shared_ptr<io_scheduler>& s) : 
+            scheduler(s),
+            thread(0),
+            previous(-1)
+    {
+    }
+    
+    io_priority_hold::~io_priority_hold()
+    {
+        this->release();
+    }
+    
+    /**
+     * @brief Gives the calling thread the priority, unless it already has it.
+     * Costs nothing while the job stays on one thread.
+     */
+    void io_priority_hold::enter()
+    {
+        if(!this->scheduler) return;
+        const int value(this->scheduler->priority_value());
+        if(value == 0) return;
+#if defined(SYS_ioprio_get) && defined(SYS_ioprio_set) && defined(SYS_gettid)
+        if(thread_id == 0) thread_id = syscall(SYS_gettid);
+        if(this->thread == thread_id) return;
+        this->release();
+        
+        //a thread already at the priority, under a scope or for good, is left to it:
+        if(applied_priority == value) return;
+        const long old(syscall(SYS_ioprio_get, ioprio_who_process, 0));
+        if((old == -1) || (syscall(SYS_ioprio_set, ioprio_who_process, 0, value) == -1)) return;
+        this->thread = thread_id;
+        this->previous = static_cast<int>(old);
+#endif
+    }
+    
+    /**
+     * @brief Puts back the priority of the thread last given it.  That need
+     * not be the calling thread.
+     */
+    void io_priority_hold::release()
+    {
+        if(this->thread == 0) return;
+#ifdef SYS_ioprio_set
+        //"who" is a thread id here:
+        syscall(SYS_ioprio_set, ioprio_who_process, this->thread, this->previous);
+#endif
+        this->thread = 0;
+    }
+    
+    
+}
@@ -0,0 +1,164 @@
+#ifndef UTILITY_IO_SCHEDULER_HPP_INCLUDED
+#define UTILITY_IO_SCHEDULER_HPP_INCLUDED
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace filesystem
+{
+    struct io_limits;
+    class io_scheduler;
+    class io_priority_scope;
+    class io_priority_hold;
+    
+    
+    /**
+     * @struct io_limits
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file io_scheduler.hpp
+     * @brief Settings for an io_scheduler.
+     */
+    struct io_limits
+    {
+        explicit io_limits();
+        
+        /* The most file data read per second, and the most metadata operations
+         * (directory opens, stats, unlinks) per second.  0 means no limit. 
+         * Up to a second's worth can be used in a burst. */
+        std::uintmax_t bytes_per_second;
+        std::uintmax_t ops_per_second;
+        
+        enum priority_class
+        {
+            //leave the I/O priority alone:
+            default_priority,
+            
+            best_effort_priority,
+            
+            //only get disk time nobody else wants:
+            idle_priority
+        };
+        
+        /* The I/O priority given to every thread doing the scheduled I/O.  
+         * priority_level (0 highest, 7 lowest) only matters for best_effort_priority. */
+        priority_class priority;
+        int priority_level;
+        
+        /* If not zero, a delay is added before each operation while the average
+         * latency of recent operations is above this, doubling for as long as it
+         * stays above and halving once it is back under. */
+        std::chrono::microseconds latency_target;
+    };
+    
+    /**
+     * @class io_scheduler
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file io_scheduler.hpp
+     * @brief Paces the I/O of traversals and copies so background jobs do not
+     * crowd out foreground work.  Put one in traversal_options::scheduler or
+     * copy_options::scheduler.  Everything sharing one scheduler shares its
+     * budget.  It is thread safe.  It is not shared across processes, so each
+     * sharded_glob worker gets its own budget.
+     */
+    class io_scheduler
+    {
+    public:
+        explicit io_scheduler(const io_limits& = io_limits());
+        
+        io_scheduler(const io_scheduler&) = delete;
+        io_scheduler& operator=(const io_scheduler&) = delete;
+        
+        void acquire_bytes(const std::uintmax_t&);
+        void acquire_ops(const std::uintmax_t& = 1);
+        void report(const std::chrono::steady_clock::duration&);
+        void apply_priority() const;
+        
+        const io_limits& limits() const;
+        
+    private:
+        friend class io_priority_scope;
+        friend class io_priority_hold;
+        
+        /* Tokens may go negative: a request larger than what is available
+         * takes it all and waits for the rest to be earned back. */
+        struct bucket
+        {
+            double tokens;
+            std::chrono::steady_clock::time_point last;
+        };
+        
+        void take(bucket&, const double&, const double&);
+        int priority_value() const;
+        
+        const io_limits settings;
+        std::mutex lock;
+        bucket bytes, ops;
+        
+        //the moving average of reported latencies, and the current back-off:
+        double average_latency;
+        std::chrono::microseconds delay;
+    };
+    
+    /**
+     * @class io_priority_scope
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file io_scheduler.hpp
+     * @brief Gives the calling thread a scheduler's I/O priority for as long
+     * as it exists, then puts back the priority the thread had.  Copies
+     * hold one while they do I/O on the caller's thread, so the caller (or
+     * a shared pool thread) is not left demoted afterwards.  A scope inside
+     * another one for the same priority does nothing.
+     */
+    class io_priority_scope
+    {
+    public:
+        explicit io_priority_scope(const std::shared_ptr<io_scheduler>&);
+        io_priority_scope(const io_priority_scope&) = delete;
+        ~io_priority_scope();
+        
+        io_priority_scope& operator=(const io_priority_scope&) = delete;
+        
+    private:
+        //the priority to put back (-1 if this scope changed nothing), and what the enclosing scope set:
+        int previous, outer;
+    };
+    
+    /**
+     * @class io_priority_hold
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file io_scheduler.hpp
+     * @brief Gives a scheduler's I/O priority to the thread running a long 
+     * job, such as a traversal, once rather than around every call.  The
+     * job calls enter() each time it is resumed.  When it is resumed on 
+     * another thread, the thread it left gets its priority back; the last
+     * one gets it back from release() or the destructor.
+     */
+    class io_priority_hold
+    {
+    public:
+        explicit io_priority_hold(const std::shared_ptr<io_scheduler>&);
+        io_priority_hold(const io_priority_hold&) = delete;
+        ~io_priority_hold();
+        
+        io_priority_hold& operator=(const io_priority_hold&) = delete;
+        
+        void enter();
+        void release();
+        
+    private:
+        std::shared_ptr<io_scheduler> scheduler;
+        
+        //the thread given the priority (0 if none), and the priority to put back:
+        long thread;
+        int previous;
+    };
+    
+    
+}
+
+#endif
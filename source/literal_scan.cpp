@@ -0,0 +1,283 @@
+#include <cctype>
+#include <cstring>
+#include <string>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "literal_scan.hpp"
+
+namespace
+{
+    bool is_quantifier(const char&);
+    std::string::size_type skip_to(const std::string&, std::string::size_type, const char&);
+    std::string::size_type escape_end(const std::string&, std::string::size_type);
+    
+    
+    inline bool is_quantifier(const char& c)
+    {
+        return ((c == '*') || (c == '+') || (c == '?') || (c == '{'));
+    }
+    
+    /**
+     * @return The index of the first "c" after "x", or the last index if there is none.
+     */
+    inline std::string::size_type skip_to(const std::string& e, std::string::size_type x, const char& c)
+    {
+        while(((x + 1) < e.size()) && (e[x + 1] != c)) ++x;
+        return (((x + 1) < e.size()) ? (x + 1) : x);
+    }
+    
+    /**
+     * @brief Finds where an escaped letter or digit ends, including its 
+     * argument: \\xHH, \\x{..}, \\cX, \\k<..>, \\gN, \\0oo, \\Q..\\E and the like.  
+     * Skipping too much only shortens the literal found, so anything 
+     * that might be an argument is skipped.
+     * @param x The index of the backslash.
+     * @return The index of the escape's last character.
+     */
+    std::string::size_type escape_end(const std::string& e, std::string::size_type x)
+    {
+        if((x + 1) >= e.size()) return x;
+        const char c(e[++x]);
+        auto is_digit = [&e](const std::string::size_type& y)->bool
+        {
+            return ((y < e.size()) && std::isdigit(static_cast<unsigned char>(e[y])));
+        };
+        
+        if(c == 'Q')
+        {
+            //quoted to the \E, or to the end:
+            std::string::size_type q(e.find("\\E", (x + 1)));
+            return ((q == std::string::npos) ? (e.size() - 1) : (q + 1));
+        }
+        if(((x + 1) < e.size()) && (e[x + 1] == '{')) return skip_to(e, (x + 1), '}');
+        switch(c)
+        {
+            case 'x':
+            {
+                for(unsigned int n(0); (n < 2) && ((x + 1) < e.size()) && 
+                        std::isxdigit(static_cast<unsigned char>(e[x + 1])); ++n) ++x;
+            }
+            break;
+            
+            case 'c':
+            case 'p':
+            case 'P':
+            {
+                if((x + 1) < e.size()) ++x;
+            }
+            break;
+            
+            case 'k':
+            case 'g':
+            {
+                if((x + 1) >= e.size()) break;
+                if(e[x + 1] == '<') return skip_to(e, (x + 1), '>');
+                if(e[x + 1] == '\'') return skip_to(e, (x + 1), '\'');
+                if(e[x + 1] == '-') ++x;
+                while(is_digit(x + 1)) ++x;
+            }
+            break;
+            
+            default:
+            {
+                //octal escapes and back references:
+                if(std::isdigit(static_cast<unsigned char>(c))) while(is_digit(x + 1)) ++x;
+            }
+            break;
+        }
+        return x;
+    }
+    
+    /* The vector scans test every position from "p" up to "last" that a whole
+     * block fits in, advancing "p" past them.  They return the first match, or
+     * null if the rest (under one block) still has to be scanned. */
+    
+#ifdef __SSE2__
+    inline const char* scan_sse2(const char*& p, const char* last, const char* needle, const std::size_t& n)
+    {
+        const __m128i first_byte(_mm_set1_epi8(needle[0]));
+        const __m128i last_byte(_mm_set1_epi8(needle[n - 1]));
+        for(; (p + 16) <= (last + 1); p += 16)
+        {
+            const __m128i a(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+            const __m128i b(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + n - 1)));
+            unsigned int mask(static_cast<unsigned int>(_mm_movemask_epi8(
+                    _mm_and_si128(_mm_cmpeq_epi8(a, first_byte), _mm_cmpeq_epi8(b, last_byte)))));
+            while(mask != 0)
+            {
+                const unsigned int bit(static_cast<unsigned int>(__builtin_ctz(mask)));
+                if(std::memcmp((p + bit + 1), (needle + 1), (n - 2)) == 0) return (p + bit);
+                mask &= (mask - 1);
+            }
+        }
+        return nullptr;
+    }
+#endif
+    
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __attribute__((target("avx2")))
+    const char* scan_avx2(const char*& p, const char* last, const char* needle, const std::size_t& n)
+    {
+        const __m256i first_byte(_mm256_set1_epi8(needle[0]));
+        const __m256i last_byte(_mm256_set1_epi8(needle[n - 1]));
+        for(; (p + 32) <= (last + 1); p += 32)
+        {
+            const __m256i a(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+            const __m256i b(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + n - 1)));
+            unsigned int mask(static_cast<unsigned int>(_mm256_movemask_epi8(
+                    _mm256_and_si256(_mm256_cmpeq_epi8(a, first_byte), _mm256_cmpeq_epi8(b, last_byte)))));
+            while(mask != 0)
+            {
+                const unsigned int bit(static_cast<unsigned int>(__builtin_ctz(mask)));
+                if(std::memcmp((p + bit + 1), (needle + 1), (n - 2)) == 0) return (p + bit);
+                mask &= (mask - 1);
+            }
+        }
+        return nullptr;
+    }
+#endif
+    
+    
+}
+
+namespace filesystem
+{
+    literal_finder::literal_finder(const std::string& s, const simd_level& l) : 
+            text(s),
+            level(l)
+    {
+    }
+    
+    /**
+     * @return The first occurrence of the needle in [begin, end), or end.  An
+     * empty needle is found at begin.
+     */
+    const char* literal_finder::find(const char* begin, const char* end) const
+    {
+        const std::size_t n(this->text.size());
+        if(n == 0) return begin;
+        if(static_cast<std::size_t>(end - begin) < n) return end;
+        
+        const char* needle(this->text.data());
+        if(n == 1)
+        {
+            const void* found(std::memchr(begin, needle[0], static_cast<std::size_t>(end - begin)));
+            return ((found == nullptr) ? end : static_cast<const char*>(found));
+        }
+        
+        //the last position a match can start at:
+        const char* last(end - n);
+        const char* p(begin);
+        const char* found(nullptr);
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        if(this->level == avx2_simd) found = scan_avx2(p, last, needle, n);
+#endif
+#ifdef __SSE2__
+        if((found == nullptr) && (this->level != scalar_simd)) found = scan_sse2(p, last, needle, n);
+#endif
+        if(found != nullptr) return found;
+        
+        while(p <= last)
+        {
+            const void* f(std::memchr(p, needle[0], static_cast<std::size_t>((last - p) + 1)));
+            if(f == nullptr) break;
+            p = static_cast<const char*>(f);
+            if((p[n - 1] == needle[n - 1]) && (std::memcmp((p + 1), (needle + 1), (n - 2)) == 0)) return p;
+            ++p;
+        }
+        return end;
+    }
+    
+    const std::string& literal_finder::needle() const
+    {
+        return this->text;
+    }
+    
+    /**
+     * @return The widest vector instructions this CPU supports, and this 
+     * library was built to use.
+     */
+    simd_level simd_support()
+    {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        static const simd_level level(__builtin_cpu_supports("avx2") ? avx2_simd : 
+                (__builtin_cpu_supports("sse2") ? sse2_simd : scalar_simd));
+        return level;
+#elif defined(__SSE2__)
+        return sse2_simd;
+#else
+        return scalar_simd;
+#endif
+    }
+    
+    /**
+     * @brief Finds a run of plain characters every match of a Perl-syntax
+     * regex must contain, so the regex only needs to run where it occurs.
+     * Only the top level of the pattern is looked at: nothing inside groups
+     * or brackets, and nothing at all if the pattern has an alternation or
+     * inline flags.
+     * @return The longest such run, or an empty string if there is none.
+     */
+    std::string required_literal(const std::string& e)
+    {
+        //inline flags like (?i) can change what the rest of the pattern means:
+        if((e.find('|') != std::string::npos) || (e.find("(?") != std::string::npos)) return std::string();
+        
+        std::string best, run;
+        auto end_run = [&]()
+        {
+            if(run.size() > best.size()) best = run;
+            run.clear();
+        };
+        
+        int depth(0);
+        for(std::string::size_type x(0); x < e.size(); ++x)
+        {
+            char c(e[x]);
+            bool literal(false);
+            if(c == '\\')
+            {
+                //escaped punctuation is itself, except the word and buffer assertions \< \> \` \';
+                //escaped letters and digits are classes, references, codes or assertions:
+                if(((x + 1) < e.size()) && (std::strchr("<>`'", e[x + 1]) != nullptr)) ++x;
+                else if(((x + 1) < e.size()) && std::ispunct(static_cast<unsigned char>(e[x + 1])))
+                {
+                    c = e[++x];
+                    literal = (depth == 0);
+                }
+                else x = escape_end(e, x);
+            }
+            else if(c == '[')
+            {
+                //skip the class, including a leading ']' or '^]':
+                ++x;
+                if((x < e.size()) && (e[x] == '^')) ++x;
+                if((x < e.size()) && (e[x] == ']')) ++x;
+                while((x < e.size()) && (e[x] != ']'))
+                {
+                    if(e[x] == '\\') ++x;
+                    ++x;
+                }
+            }
+            else if(c == '{')
+            {
+                while((x < e.size()) && (e[x] != '}')) ++x;
+            }
+            else if(c == '(') ++depth;
+            else if(c == ')') --depth;
+            else if((depth == 0) && !is_quantifier(c) && (c != '.') && (c != '^') && (c != '$')) literal = true;
+            
+            //a quantified character might not be there, and may be repeated:
+            if(literal && (((x + 1) >= e.size()) || !is_quantifier(e[x + 1]))) run += c;
+            else end_run();
+        }
+        end_run();
+        return best;
+    }
+    
+    
+}
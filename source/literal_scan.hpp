@@ -0,0 +1,47 @@
+#ifndef UTILITY_LITERAL_SCAN_HPP_INCLUDED
+#define UTILITY_LITERAL_SCAN_HPP_INCLUDED
+#include <string>
+
+namespace filesystem
+{
+    class literal_finder;
+    
+    enum simd_level
+    {
+        scalar_simd,
+        sse2_simd,
+        avx2_simd
+    };
+    
+    simd_level simd_support();
+    std::string required_literal(const std::string&);
+    
+    
+    /**
+     * @class literal_finder
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file literal_scan.hpp
+     * @brief Finds a fixed string in a buffer.  16 (SSE2) or 32 (AVX2) 
+     * positions are tested at a time against the needle's first and last
+     * bytes, and only positions where both match are compared in full.  
+     * Without either, memchr finds the candidates.  The best the CPU supports
+     * is chosen at run time unless a level is given.
+     */
+    class literal_finder
+    {
+    public:
+        explicit literal_finder(const std::string&, const simd_level& = simd_support());
+        
+        const char* find(const char*, const char*) const;
+        const std::string& needle() const;
+        
+    private:
+        std::string text;
+        simd_level level;
+    };
+    
+    
+}
+
+#endif
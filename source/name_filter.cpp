@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "name_filter.hpp"
+
+namespace
+{
+    //a token of a parsed pattern that is not a literal character:
+    const int gap(-1);
+    
+    std::vector<int> tokenize(const std::string&, bool&, bool&, bool&);
+    std::uint64_t compare_scalar(const char* const*, const std::size_t*, const std::size_t&, std::uint64_t, 
+            const std::string&, const bool&);
+    
+    
+    /**
+     * @brief Splits a POSIX basic regex into literal characters and gaps
+     * (anything that can match more than one string).
+     * @param anchored_start Set if the pattern starts with '^'.
+     * @param anchored_end Set if the pattern ends with '$'.
+     * @param unknown Set if the pattern uses something this does not
+     * understand, in which case nothing should be assumed about it.
+     */
+    inline std::vector<int> tokenize(const std::string& e, bool& anchored_start, bool& anchored_end, bool& unknown)
+    {
+        std::vector<int> tokens;
+        anchored_start = anchored_end = unknown = false;
+        
+        //a repeat makes the atom before it optional:
+        auto repeat = [&tokens]()
+        {
+            if(!tokens.empty()) tokens.back() = gap;
+            tokens.push_back(gap);
+        };
+        
+        for(std::string::size_type x(0); x < e.size(); ++x)
+        {
+            const char c(e[x]);
+            if(c == '\\')
+            {
+                if((x + 1) >= e.size())
+                {
+                    unknown = true;
+                    break;
+                }
+                const char d(e[++x]);
+                if(std::strchr(".[]\\*^$", d) != nullptr) tokens.push_back(static_cast<unsigned char>(d));
+                else if(d == '(')
+                {
+                    //the whole group is one gap:
+                    int depth(1);
+                    for(++x; ((x + 1) < e.size()) && (depth > 0); ++x)
+                    {
+                        if(e[x] != '\\') continue;
+                        if(e[x + 1] == '(') ++depth;
+                        else if(e[x + 1] == ')') --depth;
+                        ++x;
+                    }
+                    --x;
+                    if(depth > 0) unknown = true;
+                    tokens.push_back(gap);
+                }
+                else if(d == '{')
+                {
+                    const std::string::size_type close(e.find("\\}", x));
+                    if(close == std::string::npos) unknown = true;
+                    else x = (close + 1);
+                    repeat();
+                }
+                else if(d == '|') unknown = true;
+                else if(std::strchr("?+=", d) != nullptr) repeat();
+                else tokens.push_back(gap);
+            }
+            else if(c == '[')
+            {
+                ++x;
+                if((x < e.size()) && (e[x] == '^')) ++x;
+                if((x < e.size()) && (e[x] == ']')) ++x;
+                while((x < e.size()) && (e[x] != ']'))
+                {
+                    //skip [:class:], [=x=] and [.x.]:
+                    if((e[x] == '[') && ((x + 1) < e.size()) && std::strchr(":=.", e[x + 1]))
+                    {
+                        const std::string::size_type close(e.find(std::string(1, e[x + 1]) + "]", (x + 2)));
+                        if(close == std::string::npos) break;
+                        x = (close + 2);
+                        continue;
+                    }
+                    ++x;
+                }
+                if(x >= e.size()) unknown = true;
+                tokens.push_back(gap);
+            }
+            else if((c == '^') && (x == 0)) anchored_start = true;
+            else if((c == '$') && ((x + 1) == e.size())) anchored_end = true;
+            else if(c == '*') repeat();
+            else if(c == '.') tokens.push_back(gap);
+            else tokens.push_back(static_cast<unsigned char>(c));
+        }
+        return tokens;
+    }
+    
+    /**
+     * @brief Clears the bits of the names that do not start (or end) with "literal".
+     */
+    inline std::uint64_t compare_scalar(const char* const* names, const std::size_t* lengths, const std::size_t& count, 
+            std::uint64_t mask, const std::string& literal, const bool& at_end)
+    {
+        for(std::size_t x(0); x < count; ++x)
+        {
+            if(!(mask & (1ULL << x))) continue;
+            const char* start(at_end ? (names[x] + lengths[x] - literal.size()) : names[x]);
+            if(std::memcmp(start, literal.data(), literal.size()) != 0) mask &= ~(1ULL << x);
+        }
+        return mask;
+    }
+    
+#ifdef __SSE2__
+    /**
+     * @brief compare_scalar, comparing 16 bytes of each name with one
+     * instruction.  The literal is at most 16 bytes.
+     */
+    inline std::uint64_t compare_sse2(const char* const* names, const std::size_t* lengths, const std::size_t& count, 
+            std::uint64_t mask, const std::string& literal, const bool& at_end)
+    {
+        //the literal where the name's 16 bytes will be, and which bytes count:
+        char block[16] = {0};
+        const std::size_t offset(at_end ? (16 - literal.size()) : 0);
+        std::memcpy((block + offset), literal.data(), literal.size());
+        const __m128i pattern(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)));
+        const unsigned int wanted(((1u << literal.size()) - 1) << offset);
+        
+        for(std::size_t x(0); x < count; ++x)
+        {
+            if(!(mask & (1ULL << x))) continue;
+            if(lengths[x] < 16)
+            {
+                mask = (mask & ~(1ULL << x)) | compare_scalar((names + x), (lengths + x), 1, 1, literal, at_end) << x;
+                continue;
+            }
+            const char* start(at_end ? (names[x] + lengths[x] - 16) : names[x]);
+            const __m128i name(_mm_loadu_si128(reinterpret_cast<const __m128i*>(start)));
+            const unsigned int same(static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(name, pattern))));
+            if((same & wanted) != wanted) mask &= ~(1ULL << x);
+        }
+        return mask;
+    }
+#endif
+    
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    /**
+     * @brief compare_sse2, two names per instruction.
+     */
+    __attribute__((target("avx2")))
+    std::uint64_t compare_avx2(const char* const* names, const std::size_t* lengths, const std::size_t& count, 
+            std::uint64_t mask, const std::string& literal, const bool& at_end)
+    {
+        char block[16] = {0};
+        const std::size_t offset(at_end ? (16 - literal.size()) : 0);
+        std::memcpy((block + offset), literal.data(), literal.size());
+        const __m128i half(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)));
+        const __m256i pattern(_mm256_set_m128i(half, half));
+        const unsigned int wanted(((1u << literal.size()) - 1) << offset);
+        
+        //names too short for a 16 byte load are left to the scalar compare:
+        std::uint64_t shorter(0);
+        std::size_t pending(count);
+        for(std::size_t x(0); x < count; ++x)
+        {
+            if(!(mask & (1ULL << x))) continue;
+            if(lengths[x] < 16)
+            {
+                shorter |= (1ULL << x);
+                continue;
+            }
+            if(pending == count)
+            {
+                pending = x;
+                continue;
+            }
+            
+            const char* a(at_end ? (names[pending] + lengths[pending] - 16) : names[pending]);
+            const char* b(at_end ? (names[x] + lengths[x] - 16) : names[x]);
+            const __m256i both(_mm256_set_m128i(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b)), 
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(a))));
+            const unsigned int same(static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(both, pattern))));
+            if((same & wanted) != wanted) mask &= ~(1ULL << pending);
+            if(((same >> 16) & wanted) != wanted) mask &= ~(1ULL << x);
+            pending = count;
+        }
+        if(pending != count)
+        {
+            const char* a(at_end ? (names[pending] + lengths[pending] - 16) : names[pending]);
+            const __m128i name(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)));
+            const unsigned int same(static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(name, half))));
+            if((same & wanted) != wanted) mask &= ~(1ULL << pending);
+        }
+        if(shorter != 0) mask = ((mask & ~shorter) | compare_scalar(names, lengths, count, shorter, literal, at_end));
+        return mask;
+    }
+#endif
+    
+    
+}
+
+namespace filesystem
+{
+    /**
+     * @brief A filter that passes everything.
+     */
+    name_filter::name_filter() : 
+            prefix(),
+            suffix(),
+            required(),
+            min_length(0),
+            whole(false),
+            line_anchored(false),
+            level(simd_support())
+    {
+    }
+    
+    /**
+     * @param e The POSIX basic regex.
+     * @param exact true if the whole path has to match (regex_match), false
+     * if part of it does (regex_search).
+     * @param l The vector instructions to use.
+     */
+    name_filter::name_filter(const std::string& e, const bool& exact, const simd_level& l) : 
+            prefix(),
+            suffix(),
+            required(),
+            min_length(0),
+            whole(false),
+            line_anchored(false),
+            level(l)
+    {
+        bool anchored_start(false), anchored_end(false), unknown(false);
+        const std::vector<int> tokens(tokenize(e, anchored_start, anchored_end, unknown));
+        if(unknown) return;
+        this->line_anchored = (!exact && (anchored_start || anchored_end));
+        anchored_start = (anchored_start || exact);
+        anchored_end = (anchored_end || exact);
+        
+        //the literal runs, in order, and whether the first and last touch the ends:
+        std::vector<std::string> runs(1);
+        for(const int& t : tokens)
+        {
+            if(t == gap)
+            {
+                if(!runs.back().empty()) runs.push_back(std::string());
+            }
+            else runs.back() += static_cast<char>(t);
+        }
+        const bool gapless(std::find(tokens.begin(), tokens.end(), gap) == tokens.end());
+        const bool starts_literal(!tokens.empty() && (tokens.front() != gap));
+        const bool ends_literal(!tokens.empty() && (tokens.back() != gap));
+        if(runs.back().empty()) runs.pop_back();
+        if(runs.empty()) return;
+        
+        if(gapless && anchored_start && anchored_end)
+        {
+            this->prefix = runs.front();
+            this->whole = true;
+            this->min_length = this->prefix.size();
+            return;
+        }
+        
+        std::vector<std::string>::iterator first(runs.begin()), last(runs.end());
+        if(anchored_start && starts_literal) this->prefix = *(first++);
+        if(anchored_end && ends_literal && (first != last)) this->suffix = *(--last);
+        this->min_length = (this->prefix.size() + this->suffix.size());
+        
+        //the two longest of the rest, each of which must appear somewhere:
+        std::vector<std::string> rest(first, last);
+        std::sort(rest.begin(), rest.end(), [](const std::string& a, const std::string& b){ return (a.size() > b.size()); });
+        for(std::size_t x(0); (x < rest.size()) && (x < 2); ++x)
+        {
+            this->min_length += rest[x].size();
+            if(rest[x].size() > 1) this->required.emplace_back(rest[x], this->level);
+        }
+    }
+    
+    /**
+     * @return false if the regex can not match s.
+     */
+    bool name_filter::passes(const std::string& s) const
+    {
+        const char* name(s.data());
+        const std::size_t length(s.size());
+        return (this->passes(&name, &length, 1) != 0);
+    }
+    
+    /**
+     * @brief Tests up to 64 names at once.
+     * @param names The names.  They do not need to be null terminated.
+     * @param lengths Their lengths.
+     * @param count How many there are, at most 64.
+     * @return Bit x is set if names[x] passed.
+     */
+    std::uint64_t name_filter::passes(const char* const* names, const std::size_t* lengths, const std::size_t& count) const
+    {
+        const std::size_t n(std::min<std::size_t>(count, 64));
+        std::uint64_t mask((n == 64) ? ~0ULL : ((1ULL << n) - 1));
+        if(this->accepts_all()) return mask;
+        
+        //'^' and '$' also match around a newline, so names with one are not held to the ends:
+        std::uint64_t multiline(0);
+        if(this->line_anchored)
+        {
+            for(std::size_t x(0); x < n; ++x)
+            {
+                if(std::memchr(names[x], '\n', lengths[x]) != nullptr) multiline |= (1ULL << x);
+            }
+        }
+        
+        for(std::size_t x(0); x < n; ++x)
+        {
+            const bool exact_length(this->whole && !(multiline & (1ULL << x)));
+            if((lengths[x] < this->min_length) || (exact_length && (lengths[x] != this->min_length))) mask &= ~(1ULL << x);
+        }
+        
+        const std::uint64_t unanchored(mask & multiline);
+        for(int end(0); end < 2; ++end)
+        {
+            const std::string& literal(end ? this->suffix : this->prefix);
+            if(literal.empty() || (mask == 0)) continue;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+            if((this->level == avx2_simd) && (literal.size() <= 16))
+            {
+                mask = compare_avx2(names, lengths, n, mask, literal, end);
+                continue;
+            }
+#endif
+#ifdef __SSE2__
+            if((this->level != scalar_simd) && (literal.size() <= 16))
+            {
+                mask = compare_sse2(names, lengths, n, mask, literal, end);
+                continue;
+            }
+#endif
+            mask = compare_scalar(names, lengths, n, mask, literal, end);
+        }
+        mask |= unanchored;
+        
+        for(const literal_finder& f : this->required)
+        {
+            for(std::uint64_t left(mask); left != 0; left &= (left - 1))
+            {
+                const std::size_t x(static_cast<std::size_t>(__builtin_ctzll(left)));
+                const char* end(names[x] + lengths[x]);
+                if(f.find(names[x], end) == end) mask &= ~(1ULL << x);
+            }
+        }
+        return mask;
+    }
+    
+    /**
+     * @return true if every name passes.
+     */
+    bool name_filter::accepts_all() const
+    {
+        return (this->prefix.empty() && this->suffix.empty() && this->required.empty() && (this->min_length == 0));
+    }
+    
+    
+}
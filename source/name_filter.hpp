@@ -0,0 +1,55 @@
+#ifndef UTILITY_NAME_FILTER_HPP_INCLUDED
+#define UTILITY_NAME_FILTER_HPP_INCLUDED
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "literal_scan.hpp"
+
+namespace filesystem
+{
+    class name_filter;
+    
+    
+    /**
+     * @class name_filter
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file name_filter.hpp
+     * @brief A quick test that rules out most paths a glob's (POSIX basic)
+     * regex can not match, before the regex itself runs.  It checks the 
+     * literal prefix and suffix an anchored pattern must have, and the literal
+     * runs any match must contain.  Prefixes and suffixes of up to 16 bytes
+     * are compared as one SSE2 vector per name, or two names per AVX2 vector,
+     * and the runs are found with literal_finder.  It never rejects a path the
+     * regex would match.
+     */
+    class name_filter
+    {
+    public:
+        explicit name_filter();
+        name_filter(const std::string&, const bool&, const simd_level& = simd_support());
+        
+        bool passes(const std::string&) const;
+        std::uint64_t passes(const char* const*, const std::size_t*, const std::size_t&) const;
+        
+        bool accepts_all() const;
+        
+    private:
+        std::string prefix, suffix;
+        std::vector<literal_finder> required;
+        
+        //the shortest a name can be and still match, and whether it must be exactly "prefix":
+        std::size_t min_length;
+        bool whole;
+        
+        //set if the ends are pinned by '^' or '$' rather than by an exact match:
+        bool line_anchored;
+        simd_level level;
+    };
+    
+    
+}
+
+#endif
@@ -0,0 +1,522 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <boost/filesystem.hpp>
+#include <boost/regex.hpp>
+
+#include "predicate.hpp"
+
+namespace
+{
+    boost::filesystem::file_type type_of(const mode_t&);
+    
+    
+    inline boost::filesystem::file_type type_of(const mode_t& m)
+    {
+        if(S_ISREG(m)) return boost::filesystem::regular_file;
+        if(S_ISDIR(m)) return boost::filesystem::directory_file;
+        if(S_ISLNK(m)) return boost::filesystem::symlink_file;
+        if(S_ISBLK(m)) return boost::filesystem::block_file;
+        if(S_ISCHR(m)) return boost::filesystem::character_file;
+        if(S_ISFIFO(m)) return boost::filesystem::fifo_file;
+        if(S_ISSOCK(m)) return boost::filesystem::socket_file;
+        return boost::filesystem::type_unknown;
+    }
+    
+    
+}
+
+//file_metadata member functions:
+namespace filesystem
+{
+    file_metadata::file_metadata() : 
+            valid(0),
+            type(boost::filesystem::type_unknown),
+            mode(0),
+            size(0),
+            mtime(0),
+            ctime(0),
+            uid(0),
+            gid(0),
+            device(0),
+            inode(0),
+            links(0),
+            rdev(0)
+    {
+    }
+    
+    /**
+     * @brief Fills in every field from a stat structure.
+     */
+    void file_metadata::assign(const struct stat& st)
+    {
+        this->type = type_of(st.st_mode);
+        this->mode = (st.st_mode & 07777);
+        this->size = static_cast<std::uintmax_t>(st.st_size);
+        this->mtime = st.st_mtime;
+        this->ctime = st.st_ctime;
+        this->uid = st.st_uid;
+        this->gid = st.st_gid;
+        this->device = st.st_dev;
+        this->inode = st.st_ino;
+        this->links = st.st_nlink;
+        this->rdev = st.st_rdev;
+        this->valid = all_fields;
+    }
+    
+    
+}
+
+//predicate member functions:
+namespace filesystem
+{
+    struct predicate::node
+    {
+        enum kind_type
+        {
+            all_kind,
+            name_kind,
+            type_kind,
+            size_kind,
+            mtime_kind,
+            ctime_kind,
+            uid_kind,
+            gid_kind,
+            perms_kind,
+            and_kind,
+            or_kind,
+            not_kind
+        };
+        
+        explicit node(const kind_type& k) : 
+                kind(k),
+                low(0),
+                high(0),
+                from(0),
+                to(0),
+                type(boost::filesystem::type_unknown),
+                expression(),
+                exact_match(false),
+                children(),
+                needs(0),
+                cost(0)
+        {
+        }
+        
+        /**
+         * @brief Works out what the node needs once its children are set, and
+         * orders the children so the cheap ones are tried first.
+         */
+        void finish()
+        {
+            switch(this->kind)
+            {
+                case all_kind: case name_kind: this->needs = 0; break;
+                case type_kind: this->needs = file_metadata::type_field; break;
+                case size_kind: this->needs = file_metadata::size_field; break;
+                case mtime_kind: this->needs = file_metadata::mtime_field; break;
+                case ctime_kind: this->needs = file_metadata::ctime_field; break;
+                case uid_kind: case gid_kind: this->needs = file_metadata::owner_field; break;
+                case perms_kind: this->needs = file_metadata::mode_field; break;
+                default: break;
+            }
+            
+            //names cost nothing, the type usually comes free from readdir(), the rest needs a stat:
+            this->cost = ((this->needs == 0) ? 0 : ((this->needs == file_metadata::type_field) ? 1 : 2));
+            for(std::vector<std::shared_ptr<const node> >::const_iterator it(this->children.begin()); 
+                    it != this->children.end(); ++it)
+            {
+                this->needs |= (*it)->needs;
+                this->cost = std::max(this->cost, (*it)->cost);
+            }
+            std::stable_sort(this->children.begin(), this->children.end(), 
+                    [](const std::shared_ptr<const node>& a, const std::shared_ptr<const node>& b)
+                    {
+                        return (a->cost < b->cost);
+                    });
+        }
+        
+        /**
+         * @param name The entry's file name.
+         * @param md What is known about the entry so far.
+         * @param load Called to fill in fields md is missing.
+         * @param wanted Every field the whole predicate needs; requested together
+         * the first time a stat is unavoidable.
+         */
+        bool evaluate(const std::string& name, file_metadata& md, const loader& load, 
+                const unsigned int& wanted) const
+        {
+            switch(this->kind)
+            {
+                case all_kind: return true;
+                
+                case name_kind:
+                {
+                    if(this->exact_match) return boost::regex_match(name, this->expression);
+                    return boost::regex_search(name, this->expression);
+                }
+                
+                case and_kind:
+                {
+                    for(std::vector<std::shared_ptr<const node> >::const_iterator it(this->children.begin()); 
+                            it != this->children.end(); ++it)
+                    {
+                        if(!(*it)->evaluate(name, md, load, wanted)) return false;
+                    }
+                    return true;
+                }
+                
+                case or_kind:
+                {
+                    for(std::vector<std::shared_ptr<const node> >::const_iterator it(this->children.begin()); 
+                            it != this->children.end(); ++it)
+                    {
+                        if((*it)->evaluate(name, md, load, wanted)) return true;
+                    }
+                    return false;
+                }
+                
+                case not_kind: return !this->children.front()->evaluate(name, md, load, wanted);
+                
+                default: break;
+            }
+            
+            if((md.valid & this->needs) != this->needs) load(md, (wanted | this->needs));
+            if((md.valid & this->needs) != this->needs) return false;
+            
+            switch(this->kind)
+            {
+                case type_kind: return (md.type == this->type);
+                case size_kind: return ((md.size >= this->low) && (md.size <= this->high));
+                case mtime_kind: return ((md.mtime >= this->from) && (md.mtime <= this->to));
+                case ctime_kind: return ((md.ctime >= this->from) && (md.ctime <= this->to));
+                case uid_kind: return (md.uid == this->low);
+                case gid_kind: return (md.gid == this->low);
+                case perms_kind: return ((md.mode & this->low) == this->low);
+                default: break;
+            }
+            return false;
+        }
+        
+        kind_type kind;
+        std::uintmax_t low, high;
+        std::time_t from, to;
+        boost::filesystem::file_type type;
+        boost::regex expression;
+        bool exact_match;
+        std::vector<std::shared_ptr<const node> > children;
+        unsigned int needs, cost;
+    };
+    
+    predicate::predicate() : 
+            root(new node(node::all_kind))
+    {
+    }
+    
+    predicate::predicate(const predicate& p) : 
+            root(p.root)
+    {
+    }
+    
+    predicate::predicate(const std::shared_ptr<const node>& n) : 
+            root(n)
+    {
+    }
+    
+    predicate::~predicate()
+    {
+    }
+    
+    predicate& predicate::operator=(const predicate& p)
+    {
+        if(this != &p)
+        {
+            this->root = p.root;
+        }
+        return *this;
+    }
+    
+    /**
+     * @brief Matches the entry's file name against a regular expression, the
+     * same way glob does.
+     * @param r The regex.
+     * @param e If true, the whole name must match.
+     */
+    predicate predicate::named(const std::string& r, const bool& e)
+    {
+        std::shared_ptr<node> n(new node(node::name_kind));
+        n->expression = boost::regex(r, boost::regex::basic);
+        n->exact_match = e;
+        n->finish();
+        return predicate(n);
+    }
+    
+    /**
+     * @brief Matches entries of a type.  Symbolic links are not followed.
+     */
+    predicate predicate::of_type(const boost::filesystem::file_type& t)
+    {
+        std::shared_ptr<node> n(new node(node::type_kind));
+        n->type = t;
+        n->finish();
+        return predicate(n);
+    }
+    
+    /**
+     * @brief Matches entries whose size is within [min, max].
+     */
+    predicate predicate::size_between(const std::uintmax_t& min, const std::uintmax_t& max)
+    {
+        std::shared_ptr<node> n(new node(node::size_kind));
+        n->low = min;
+        n->high = max;
+        n->finish();
+        return predicate(n);
+    }
+    
+    /**
+     * @brief Matches entries whose modification time is within [from, to].
+     */
+    predicate predicate::modified_between(const std::time_t& from, const std::time_t& to)
+    {
+        std::shared_ptr<node> n(new node(node::mtime_kind));
+        n->from = from;
+        n->to = to;
+        n->finish();
+        return predicate(n);
+    }
+    
+    /**
+     * @brief Matches entries whose status change time is within [from, to].
+     */
+    predicate predicate::changed_between(const std::time_t& from, const std::time_t& to)
+    {
+        std::shared_ptr<node> n(new node(node::ctime_kind));
+        n->from = from;
+        n->to = to;
+        n->finish();
+        return predicate(n);
+    }
+    
+    predicate predicate::owned_by(const unsigned int& uid)
+    {
+        std::shared_ptr<node> n(new node(node::uid_kind));
+        n->low = uid;
+        n->finish();
+        return predicate(n);
+    }
+    
+    predicate predicate::in_group(const unsigned int& gid)
+    {
+        std::shared_ptr<node> n(new node(node::gid_kind));
+        n->low = gid;
+        n->finish();
+        return predicate(n);
+    }
+    
+    /**
+     * @brief Matches entries that have all of the given permission bits set.
+     */
+    predicate predicate::with_permissions(const unsigned int& bits)
+    {
+        std::shared_ptr<node> n(new node(node::perms_kind));
+        n->low = bits;
+        n->finish();
+        return predicate(n);
+    }
+    
+    predicate operator&&(const predicate& a, const predicate& b)
+    {
+        typedef predicate::node node;
+        
+        if(a.accepts_all()) return b;
+        if(b.accepts_all()) return a;
+        
+        std::shared_ptr<node> n(new node(node::and_kind));
+        for(const predicate* p : {&a, &b})
+        {
+            //flatten chains so the whole chain is ordered by cost:
+            if(p->root->kind == node::and_kind) n->children.insert(n->children.end(), 
+                    p->root->children.begin(), p->root->children.end());
+            else n->children.push_back(p->root);
+        }
+        n->finish();
+        return predicate(n);
+    }
+    
+    predicate operator||(const predicate& a, const predicate& b)
+    {
+        typedef predicate::node node;
+        
+        if(a.accepts_all()) return a;
+        if(b.accepts_all()) return b;
+        
+        std::shared_ptr<node> n(new node(node::or_kind));
+        for(const predicate* p : {&a, &b})
+        {
+            if(p->root->kind == node::or_kind) n->children.insert(n->children.end(), 
+                    p->root->children.begin(), p->root->children.end());
+            else n->children.push_back(p->root);
+        }
+        n->finish();
+        return predicate(n);
+    }
+    
+    predicate operator!(const predicate& a)
+    {
+        typedef predicate::node node;
+        
+        std::shared_ptr<node> n(new node(node::not_kind));
+        n->children.push_back(a.root);
+        n->finish();
+        return predicate(n);
+    }
+    
+    /**
+     * @brief Tests a path, stat'ing it only if the predicate needs it.
+     */
+    bool predicate::operator()(const boost::filesystem::path& p) const
+    {
+        file_metadata md;
+        return this->matches(p.filename().string(), md, 
+                [&p](file_metadata& m, const unsigned int& fields)
+                {
+                    stat_entry(AT_FDCWD, p.c_str(), m, fields);
+                });
+    }
+    
+    /**
+     * @brief Tests an entry.
+     * @param name The entry's file name.
+     * @param md Whatever is already known about the entry.  Fields loaded
+     * during the test are left in it.
+     * @param load Called to fill in the fields md is missing.
+     */
+    bool predicate::matches(const std::string& name, file_metadata& md, const loader& load) const
+    {
+        return this->root->evaluate(name, md, load, this->root->needs);
+    }
+    
+    /**
+     * @return The file_metadata fields this predicate may look at.
+     */
+    unsigned int predicate::fields() const
+    {
+        return this->root->needs;
+    }
+    
+    /**
+     * @return true if this predicate matches everything.
+     */
+    bool predicate::accepts_all() const
+    {
+        return (this->root->kind == node::all_kind);
+    }
+    
+    
+}
+
+namespace filesystem
+{
+    /**
+     * @brief Stats a directory entry without following symbolic links.  Uses
+     * statx() where available, so only the fields asked for are fetched.
+     * @param dir The directory containing the entry, or AT_FDCWD.
+     * @param name The entry's name within dir.
+     * @param md Receives the fields.  Fields already valid that were not
+     * asked for are kept.
+     * @param fields The file_metadata fields wanted.
+     * @return false if the entry could not be stat'd.
+     */
+    bool stat_entry(const int& dir, const char* name, file_metadata& md, const unsigned int& fields)
+    {
+#ifdef STATX_TYPE
+        unsigned int mask(0);
+        if(fields & file_metadata::type_field) mask |= STATX_TYPE;
+        if(fields & file_metadata::mode_field) mask |= STATX_MODE;
+        if(fields & file_metadata::size_field) mask |= STATX_SIZE;
+        if(fields & file_metadata::mtime_field) mask |= STATX_MTIME;
+        if(fields & file_metadata::ctime_field) mask |= STATX_CTIME;
+        if(fields & file_metadata::owner_field) mask |= (STATX_UID | STATX_GID);
+        if(fields & file_metadata::inode_field) mask |= (STATX_INO | STATX_NLINK);
+        
+        struct statx stx;
+        if(statx(dir, name, (AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT), mask, &stx) == 0)
+        {
+            if(stx.stx_mask & STATX_TYPE)
+            {
+                md.type = type_of(stx.stx_mode);
+                md.valid |= file_metadata::type_field;
+            }
+            if(stx.stx_mask & STATX_MODE)
+            {
+                md.mode = (stx.stx_mode & 07777);
+                md.valid |= file_metadata::mode_field;
+            }
+            if(stx.stx_mask & STATX_SIZE)
+            {
+                md.size = stx.stx_size;
+                md.valid |= file_metadata::size_field;
+            }
+            if(stx.stx_mask & STATX_MTIME)
+            {
+                md.mtime = stx.stx_mtime.tv_sec;
+                md.valid |= file_metadata::mtime_field;
+            }
+            if(stx.stx_mask & STATX_CTIME)
+            {
+                md.ctime = stx.stx_ctime.tv_sec;
+                md.valid |= file_metadata::ctime_field;
+            }
+            if((stx.stx_mask & (STATX_UID | STATX_GID)) == (STATX_UID | STATX_GID))
+            {
+                md.uid = stx.stx_uid;
+                md.gid = stx.stx_gid;
+                md.valid |= file_metadata::owner_field;
+            }
+            if((stx.stx_mask & (STATX_INO | STATX_NLINK)) == (STATX_INO | STATX_NLINK))
+            {
+                md.device = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+                md.inode = stx.stx_ino;
+                md.links = stx.stx_nlink;
+                md.rdev = makedev(stx.stx_rdev_major, stx.stx_rdev_minor);
+                md.valid |= file_metadata::inode_field;
+            }
+            return true;
+        }
+        if(errno != ENOSYS) return false;
+#endif
+        struct stat st;
+        if(fstatat(dir, name, &st, AT_SYMLINK_NOFOLLOW) != 0) return false;
+        
+        //every field comes back, but like statx() only the ones asked for replace what is known:
+        const file_metadata known(md);
+        const unsigned int keep(known.valid & ~fields);
+        md.assign(st);
+        if(keep & file_metadata::type_field) md.type = known.type;
+        if(keep & file_metadata::mode_field) md.mode = known.mode;
+        if(keep & file_metadata::size_field) md.size = known.size;
+        if(keep & file_metadata::mtime_field) md.mtime = known.mtime;
+        if(keep & file_metadata::ctime_field) md.ctime = known.ctime;
+        if(keep & file_metadata::owner_field)
+        {
+            md.uid = known.uid;
+            md.gid = known.gid;
+        }
+        if(keep & file_metadata::inode_field)
+        {
+            md.device = known.device;
+            md.inode = known.inode;
+            md.links = known.links;
+            md.rdev = known.rdev;
+        }
+        return true;
+    }
+    
+    
+}
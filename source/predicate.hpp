@@ -0,0 +1,117 @@
+#ifndef UTILITY_PREDICATE_HPP_INCLUDED
+#define UTILITY_PREDICATE_HPP_INCLUDED
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+
+namespace filesystem
+{
+    struct file_metadata;
+    class predicate;
+    
+    
+    /**
+     * @struct file_metadata
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file predicate.hpp
+     * @brief The parts of a stat() that traversals and predicates care about.
+     * Only the fields named in "valid" have been filled in.
+     */
+    struct file_metadata
+    {
+        enum field
+        {
+            type_field = 0x01,
+            mode_field = 0x02,
+            size_field = 0x04,
+            mtime_field = 0x08,
+            ctime_field = 0x10,
+            owner_field = 0x20,
+            inode_field = 0x40,
+            all_fields = 0x7f
+        };
+        
+        explicit file_metadata();
+        
+        void assign(const struct stat&);
+        
+        unsigned int valid;
+        boost::filesystem::file_type type;
+        unsigned int mode;
+        std::uintmax_t size;
+        std::time_t mtime, ctime;
+        unsigned int uid, gid;
+        
+        /* "rdev" is the number of a device file; it comes with inode_field. */
+        std::uintmax_t device, inode, links, rdev;
+    };
+    
+    /**
+     * @class predicate
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file predicate.hpp
+     * @brief A composable test on a directory entry's name and metadata.
+     * Combine predicates with &&, || and !.  When evaluated, the cheap tests
+     * (name, then type) run before the ones that need a stat, and when a stat
+     * is needed it asks for only the fields the whole predicate uses.  A
+     * default constructed predicate matches everything.
+     */
+    class predicate
+    {
+    public:
+        /* Fills in (at least) the requested file_metadata fields. */
+        typedef std::function<void(file_metadata&, const unsigned int&)> loader;
+        
+        explicit predicate();
+        predicate(const predicate&);
+        ~predicate();
+        
+        predicate& operator=(const predicate&);
+        
+        static predicate named(const std::string&, const bool& = false);
+        static predicate of_type(const boost::filesystem::file_type&);
+        static predicate size_between(const std::uintmax_t&, 
+                const std::uintmax_t& = std::numeric_limits<std::uintmax_t>::max());
+        static predicate modified_between(const std::time_t&, 
+                const std::time_t& = std::numeric_limits<std::time_t>::max());
+        static predicate changed_between(const std::time_t&, 
+                const std::time_t& = std::numeric_limits<std::time_t>::max());
+        static predicate owned_by(const unsigned int&);
+        static predicate in_group(const unsigned int&);
+        static predicate with_permissions(const unsigned int&);
+        
+        friend predicate operator&&(const predicate&, const predicate&);
+        friend predicate operator||(const predicate&, const predicate&);
+        friend predicate operator!(const predicate&);
+        
+        bool operator()(const boost::filesystem::path&) const;
+        bool matches(const std::string&, file_metadata&, const loader&) const;
+        
+        unsigned int fields() const;
+        bool accepts_all() const;
+        
+    private:
+        struct node;
+        
+        explicit predicate(const std::shared_ptr<const node>&);
+        
+        std::shared_ptr<const node> root;
+    };
+    
+    predicate operator&&(const predicate&, const predicate&);
+    predicate operator||(const predicate&, const predicate&);
+    predicate operator!(const predicate&);
+    
+    bool stat_entry(const int&, const char*, file_metadata&, const unsigned int& = file_metadata::all_fields);
+    
+    
+}
+
+#endif
@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+
+#include "remove_tree.hpp"
+
+using boost::filesystem::path;
+
+namespace
+{
+    struct node;
+    class remover;
+    
+    boost::filesystem::file_type entry_type(const int&, const struct dirent*, filesystem::file_metadata&);
+    
+    
+    /**
+     * @brief A directory being emptied.  It is removed once "pending" reaches
+     * zero: one count for its own scan, and one for each subdirectory.
+     */
+    struct node
+    {
+        std::shared_ptr<node> parent;
+        std::string name;
+        path full;
+        int level;
+        int fd;
+        
+        //only the root can be something other than a directory:
+        bool directory;
+        
+        //false if the filter rejected the directory itself:
+        bool accepted;
+        std::atomic<bool> kept;
+        std::atomic<std::size_t> pending;
+        
+        //a directory is only left open if the removal was stopped:
+        ~node()
+        {
+            if(this->fd != -1) ::close(this->fd);
+        }
+    };
+    
+    /**
+     * @brief The state shared by the threads of one remove_tree call.
+     */
+    class remover
+    {
+    public:
+        remover(const filesystem::remove_options& o, filesystem::remove_result& r) : 
+                removed(0),
+                options(o),
+                result(r),
+                device(0),
+                result_lock(),
+                work_lock(),
+                work_ready(),
+                work(),
+                active(0),
+                stop(false),
+                error()
+        {
+        }
+        
+        /**
+         * @brief Queues a directory.
+         */
+        void add(const std::shared_ptr<node>& n)
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->work_lock);
+                this->work.push_back(n);
+            }
+            this->work_ready.notify_one();
+        }
+        
+        /**
+         * @brief Takes directories off the queue until every one is finished.
+         * Newest first, so each thread works depth-first and few directories
+         * are held open at once.  Anything thrown (by the filter, say) stops
+         * every thread, and is kept for remove_tree to rethrow.
+         */
+        void run()
+        {
+            const filesystem::io_priority_scope priority(this->options.traversal.scheduler);
+            try
+            {
+                while(true)
+                {
+                    std::shared_ptr<node> n;
+                    {
+                        std::unique_lock<std::mutex> lock(this->work_lock);
+                        this->work_ready.wait(lock, [this](){ return (this->stop || !this->work.empty() || (this->active == 0)); });
+                        if(this->stop || this->work.empty()) break;
+                        n = std::move(this->work.back());
+                        this->work.pop_back();
+                        ++(this->active);
+                    }
+                    this->scan(n);
+                    {
+                        std::lock_guard<std::mutex> lock(this->work_lock);
+                        --(this->active);
+                    }
+                    this->work_ready.notify_all();
+                }
+            }
+            catch(...)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(this->work_lock);
+                    if(!this->error) this->error = std::current_exception();
+                    this->stop = true;
+                }
+                this->work_ready.notify_all();
+            }
+        }
+        
+        /**
+         * @brief Rethrows what stopped the threads, if anything did.  Call
+         * once they have all been joined.
+         */
+        void rethrow() const
+        {
+            if(this->error) std::rethrow_exception(this->error);
+        }
+        
+        /**
+         * @brief Deletes what it can of a directory's contents, queueing its
+         * subdirectories.
+         */
+        void scan(const std::shared_ptr<node>& n)
+        {
+            const int flags(O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if(this->options.traversal.scheduler) this->options.traversal.scheduler->acquire_ops();
+            if(n->parent) n->fd = openat(n->parent->fd, n->name.c_str(), flags);
+            else n->fd = ::open(n->full.c_str(), flags);
+            if(n->fd == -1)
+            {
+                this->fail(n->full, errno);
+                n->kept = true;
+                this->finish(n);
+                return;
+            }
+            
+            if(this->options.traversal.same_filesystem)
+            {
+                struct stat st;
+                if(fstat(n->fd, &st) == -1) st.st_dev = this->device;
+                if(!n->parent) this->device = st.st_dev;
+                else if(st.st_dev != this->device)
+                {
+                    n->kept = true;
+                    this->finish(n);
+                    return;
+                }
+            }
+            
+            //the DIR gets its own descriptor, so n->fd outlives the scan:
+            int scan_fd(dup(n->fd));
+            DIR* handle((scan_fd == -1) ? nullptr : fdopendir(scan_fd));
+            if(handle == nullptr)
+            {
+                this->fail(n->full, errno);
+                if(scan_fd != -1) ::close(scan_fd);
+                n->kept = true;
+                this->finish(n);
+                return;
+            }
+            
+            const bool stop((this->options.traversal.max_depth >= 0) && 
+                    ((n->level + 1) >= this->options.traversal.max_depth));
+            for(struct dirent* d(readdir(handle)); d != nullptr; d = readdir(handle))
+            {
+                if(!strcmp(d->d_name, ".") || !strcmp(d->d_name, "..")) continue;
+                
+                path full(n->full / d->d_name);
+                if(this->excluded(d->d_name, full))
+                {
+                    n->kept = true;
+                    continue;
+                }
+                
+                filesystem::file_metadata md;
+                const boost::filesystem::file_type t(entry_type(n->fd, d, md));
+                const bool accepted(this->accept(n->fd, d->d_name, md));
+                if(t == boost::filesystem::directory_file)
+                {
+                    if(stop)
+                    {
+                        n->kept = true;
+                        continue;
+                    }
+                    
+                    std::shared_ptr<node> child(new node());
+                    child->parent = n;
+                    child->name = d->d_name;
+                    child->full = std::move(full);
+                    child->level = (n->level + 1);
+                    child->fd = -1;
+                    child->directory = true;
+                    child->accepted = accepted;
+                    child->kept = false;
+                    child->pending = 1;
+                    ++(n->pending);
+                    this->add(child);
+                }
+                else if(!accepted) n->kept = true;
+                else if(!this->unlink(n->fd, d->d_name, full, 0)) n->kept = true;
+            }
+            closedir(handle);
+            this->finish(n);
+        }
+        
+        /**
+         * @brief Called when one of a directory's counts is done.  The last one
+         * removes the directory, then finishes its parent's count in turn.
+         */
+        void finish(std::shared_ptr<node> n)
+        {
+            while(n && (--(n->pending) == 0))
+            {
+                if(n->fd != -1) ::close(n->fd);
+                n->fd = -1;
+                
+                const std::shared_ptr<node>& p(n->parent);
+                bool gone(false);
+                if(!n->kept && n->accepted)
+                {
+                    gone = this->unlink((p ? p->fd : AT_FDCWD), (p ? n->name.c_str() : n->full.c_str()), n->full, 
+                            (n->directory ? AT_REMOVEDIR : 0));
+                }
+                if(p && !gone) p->kept = true;
+                n = p;
+            }
+        }
+        
+        std::atomic<std::uintmax_t> removed;
+        
+    private:
+        /**
+         * @return true if the entry was deleted (or would have been).
+         */
+        bool unlink(const int& fd, const char* name, const path& full, const int& flags)
+        {
+            if(this->options.dry_run)
+            {
+                std::lock_guard<std::mutex> lock(this->result_lock);
+                this->result.listed.push_back(full);
+            }
+            else if(!this->timed_unlink(fd, name, flags))
+            {
+                //somebody else got there first:
+                if(errno == ENOENT) return true;
+                this->fail(full, errno);
+                return false;
+            }
+            ++(this->removed);
+            return true;
+        }
+        
+        bool timed_unlink(const int& fd, const char* name, const int& flags)
+        {
+            const std::shared_ptr<filesystem::io_scheduler>& scheduler(this->options.traversal.scheduler);
+            if(!scheduler) return (unlinkat(fd, name, flags) == 0);
+            
+            scheduler->acquire_ops();
+            const std::chrono::steady_clock::time_point started(std::chrono::steady_clock::now());
+            const bool removed(unlinkat(fd, name, flags) == 0);
+            scheduler->report(std::chrono::steady_clock::now() - started);
+            return removed;
+        }
+        
+        void fail(const path& p, const int& e)
+        {
+            using boost::filesystem::filesystem_error;
+            using boost::system::error_code;
+            using boost::system::system_category;
+            
+            std::lock_guard<std::mutex> lock(this->result_lock);
+            this->result.errors.push_back(filesystem_error("Can not remove!", p, error_code(e, system_category())));
+        }
+        
+        bool excluded(const char* name, const path& full) const
+        {
+            if(!this->options.traversal.excluded_names.empty() && 
+                    (this->options.traversal.excluded_names.count(name) > 0)) return true;
+            return (!this->options.traversal.excluded_paths.empty() && 
+                    (this->options.traversal.excluded_paths.count(full.string()) > 0));
+        }
+        
+        bool accept(const int& fd, const char* name, filesystem::file_metadata& md) const
+        {
+            if(this->options.traversal.filter.accepts_all()) return true;
+            return this->options.traversal.filter.matches(name, md, 
+                    [fd, name](filesystem::file_metadata& m, const unsigned int& fields)
+                    {
+                        filesystem::stat_entry(fd, name, m, fields);
+                    });
+        }
+        
+        const filesystem::remove_options& options;
+        filesystem::remove_result& result;
+        dev_t device;
+        std::mutex result_lock;
+        
+        std::mutex work_lock;
+        std::condition_variable work_ready;
+        std::vector<std::shared_ptr<node> > work;
+        unsigned int active;
+        bool stop;
+        std::exception_ptr error;
+    };
+    
+    /**
+     * @return The type of a directory entry, from d_type when the filesystem
+     * provides it.
+     */
+    inline boost::filesystem::file_type entry_type(const int& fd, const struct dirent* d, filesystem::file_metadata& md)
+    {
+        using filesystem::file_metadata;
+        
+        boost::filesystem::file_type t(boost::filesystem::type_unknown);
+        switch(d->d_type)
+        {
+            case DT_REG: t = boost::filesystem::regular_file; break;
+            case DT_DIR: t = boost::filesystem::directory_file; break;
+            case DT_LNK: t = boost::filesystem::symlink_file; break;
+            case DT_BLK: t = boost::filesystem::block_file; break;
+            case DT_CHR: t = boost::filesystem::character_file; break;
+            case DT_FIFO: t = boost::filesystem::fifo_file; break;
+            case DT_SOCK: t = boost::filesystem::socket_file; break;
+            default:
+            {
+                if(filesystem::stat_entry(fd, d->d_name, md)) t = md.type;
+            }
+            break;
+        }
+        md.type = t;
+        md.valid |= file_metadata::type_field;
+        return t;
+    }
+    
+    
+}
+
+namespace filesystem
+{
+    remove_options::remove_options() : 
+            threads(std::max(1u, std::thread::hardware_concurrency())),
+            dry_run(false),
+            traversal()
+    {
+    }
+    
+    remove_result::remove_result() : 
+            removed(0),
+            listed(),
+            errors()
+    {
+    }
+    
+    /**
+     * @brief Deletes a file or directory tree, like remove_all, but through
+     * directory handles instead of full paths, with sibling subtrees deleted
+     * in parallel.  Each directory is removed after its contents.  Failures
+     * to delete are collected rather than thrown, and whatever can be deleted
+     * is.  Anything else thrown, such as a filter's regex giving up, stops
+     * the removal and is rethrown once every thread has finished.
+     * @param p The file or directory to delete.  It is not subject to the
+     * exclusions, but is to the filter.
+     * @param o The settings.
+     * @return What was deleted, and what went wrong.
+     */
+    remove_result remove_tree(const path& p, const remove_options& o)
+    {
+        remove_result result;
+        remover r(o, result);
+        
+        file_metadata md;
+        if(!stat_entry(AT_FDCWD, p.c_str(), md, file_metadata::type_field))
+        {
+            if(errno != ENOENT)
+            {
+                using boost::filesystem::filesystem_error;
+                using boost::system::error_code;
+                using boost::system::system_category;
+                
+                result.errors.push_back(filesystem_error("Can not remove!", p, error_code(errno, system_category())));
+            }
+            return result;
+        }
+        const bool accepted(o.traversal.filter.accepts_all() || o.traversal.filter(p));
+        
+        std::shared_ptr<node> root(new node());
+        root->name = p.string();
+        root->full = p;
+        root->level = -1;
+        root->fd = -1;
+        root->directory = (md.type == boost::filesystem::directory_file);
+        root->accepted = accepted;
+        root->kept = false;
+        root->pending = 1;
+        if(root->directory)
+        {
+            r.add(root);
+            std::vector<std::thread> threads;
+            for(unsigned int x(1); x < o.threads; ++x) threads.emplace_back(&remover::run, &r);
+            r.run();
+            for(std::thread& t : threads) t.join();
+            r.rethrow();
+        }
+        else r.finish(root);
+        
+        result.removed = r.removed;
+        return result;
+    }
+    
+    
+}
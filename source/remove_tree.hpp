@@ -0,0 +1,71 @@
+#ifndef UTILITY_REMOVE_TREE_HPP_INCLUDED
+#define UTILITY_REMOVE_TREE_HPP_INCLUDED
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "filesystem.hpp"
+
+namespace filesystem
+{
+    struct remove_options;
+    struct remove_result;
+    
+    
+    /**
+     * @struct remove_options
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file remove_tree.hpp
+     * @brief Settings for remove_tree.
+     */
+    struct remove_options
+    {
+        explicit remove_options();
+        
+        /* The number of threads deleting sibling subtrees.  Defaults to the 
+         * number of CPUs. */
+        unsigned int threads;
+        
+        /* If true, nothing is deleted; remove_result::listed gets every path that
+         * would have been. */
+        bool dry_run;
+        
+        /* Excluded entries, and entries the filter rejects, are kept, and so is
+         * every directory above them.  Directories the filter rejects are still
+         * emptied of what it accepts.  Directories beyond max_depth, or on
+         * another filesystem when same_filesystem is set, are kept whole.  The
+         * scheduler paces directory opens and unlinks.  max_open_fds and 
+         * follow_symlinks are not used: links are removed, never followed. */
+        traversal_options traversal;
+    };
+    
+    /**
+     * @struct remove_result
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file remove_tree.hpp
+     * @brief What remove_tree did.
+     */
+    struct remove_result
+    {
+        explicit remove_result();
+        
+        /* The number of entries deleted (or that would have been, in a dry run). */
+        std::uintmax_t removed;
+        
+        /* Dry runs only: the entries that would have been deleted, each directory
+         * after its contents. */
+        std::vector<boost::filesystem::path> listed;
+        
+        /* Every failure.  The entries involved, and the directories above them,
+         * are left in place. */
+        std::vector<boost::filesystem::filesystem_error> errors;
+    };
+    
+    remove_result remove_tree(const boost::filesystem::path&, const remove_options& = remove_options());
+    
+    
+}
+
+#endif
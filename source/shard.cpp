@@ -0,0 +1,629 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <boost/filesystem.hpp>
+#include <boost/regex.hpp>
+
+#include "shard.hpp"
+
+using boost::filesystem::path;
+using boost::filesystem::directory_entry;
+
+namespace
+{
+    /* Every message is one SOCK_SEQPACKET datagram, starting with one of these. */
+    
+    //coordinator to worker:
+    const char walk_message('W');
+    const char steal_message('S');
+    const char quit_message('Q');
+    
+    //worker to coordinator:
+    const char results_message('R');
+    const char donate_message('D');
+    const char idle_message('I');
+    const char error_message('E');
+    
+    const std::size_t max_message(64 * 1024);
+    
+    //matches are sent in batches of about this many bytes:
+    const std::size_t batch_limit(32 * 1024);
+    
+    //how many entries a worker walks between checks for steal requests:
+    const unsigned int poll_interval(64);
+    
+    struct shard;
+    
+    bool send_message(const int&, const std::string&);
+    std::string shard_message(const char&, const shard&);
+    shard parse_shard(const char*, const std::size_t&);
+    std::string error_text(const boost::system::error_code&, const path&, const std::string&);
+    void worker_walk(const int&, const shard&, const filesystem::shard_options&);
+    void worker_main(const int&, const filesystem::shard_options&);
+    
+    
+    /**
+     * @brief A subtree to walk.
+     */
+    struct shard
+    {
+        path root;
+        
+        //the level of "root" itself, counted from the real root's entries.  -1 for the real root:
+        std::int32_t depth;
+        
+        //the device of the real root, for same_filesystem:
+        std::uint64_t device;
+    };
+    
+    inline bool send_message(const int& sock, const std::string& m)
+    {
+        return (send(sock, m.data(), m.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(m.size()));
+    }
+    
+    inline std::string shard_message(const char& type, const shard& s)
+    {
+        std::string m(1, type);
+        m.append(reinterpret_cast<const char*>(&s.depth), sizeof(s.depth));
+        m.append(reinterpret_cast<const char*>(&s.device), sizeof(s.device));
+        m += s.root.string();
+        return m;
+    }
+    
+    inline shard parse_shard(const char* data, const std::size_t& size)
+    {
+        shard s;
+        const std::size_t header(1 + sizeof(s.depth) + sizeof(s.device));
+        std::memcpy(&s.depth, (data + 1), sizeof(s.depth));
+        std::memcpy(&s.device, (data + 1 + sizeof(s.depth)), sizeof(s.device));
+        s.root = std::string((data + header), (size - header));
+        return s;
+    }
+    
+    /**
+     * @brief Describes an error that ended a walk, for the coordinator to rethrow.
+     */
+    inline std::string error_text(const boost::system::error_code& ec, const path& p, const std::string& what)
+    {
+        const std::int32_t code(ec.value());
+        std::string m(1, error_message);
+        m.append(reinterpret_cast<const char*>(&code), sizeof(code));
+        m += p.string();
+        m += '\0';
+        m += what.substr(0, 1024);
+        return m;
+    }
+    
+    /**
+     * @brief Walks one shard with a recursive_iterator, sending back the
+     * matches.  When the coordinator asks for work, the next directory
+     * that would have been descended into is handed back instead.
+     */
+    inline void worker_walk(const int& sock, const shard& s, const filesystem::shard_options& o)
+    {
+        using filesystem::recursive_iterator;
+        using filesystem::traversal_options;
+        using filesystem::file_metadata;
+        using filesystem::predicate;
+        using filesystem::name_filter;
+        
+        traversal_options t(o.traversal);
+        if(t.max_depth >= 0)
+        {
+            t.max_depth -= (s.depth + 1);
+            if(t.max_depth < 0) return;
+        }
+        
+        //the filter is applied here, so directories it rejects can still be handed out:
+        const predicate filter(o.traversal.filter);
+        t.filter = predicate();
+        
+        const bool match_all(o.expression.empty());
+        const boost::regex expression(match_all ? std::string(".") : o.expression, boost::regex::basic);
+        const name_filter prefilter(o.expression, o.exact_match);
+        std::string batch(1, results_message);
+        std::vector<char> incoming(max_message);
+        bool steal(false);
+        unsigned int count(0);
+        
+        recursive_iterator it;
+        try
+        {
+            it = recursive_iterator(s.root, t);
+        }
+        catch(const boost::filesystem::filesystem_error&)
+        {
+            //an unreadable shard root is skipped, like any other unreadable directory.
+            return;
+        }
+        
+        //anything else that ends the walk early is the coordinator's to report:
+        try
+        {
+            for(; !it.end(); ++it)
+            {
+                if((++count % poll_interval) == 0)
+                {
+                    ssize_t n(0);
+                    while((n = recv(sock, incoming.data(), incoming.size(), MSG_DONTWAIT)) > 0)
+                    {
+                        if(incoming[0] == quit_message) _exit(0);
+                        if(incoming[0] == steal_message) steal = true;
+                    }
+                    if(n == 0) _exit(0);
+                }
+                
+                bool wanted(match_all || (prefilter.passes(it->path().string()) && 
+                        filesystem::path_matches(it->path(), expression, o.exact_match)));
+                if(wanted && !filter.accepts_all())
+                {
+                    file_metadata md(it.metadata(file_metadata::type_field));
+                    wanted = filter.matches(it->path().filename().string(), md, 
+                            [&it](file_metadata& m, const unsigned int& fields)
+                            {
+                                m = it.metadata(fields);
+                            });
+                }
+                if(wanted)
+                {
+                    batch += static_cast<char>(it->symlink_status().type());
+                    batch += it->path().string();
+                    batch += '\0';
+                    if(batch.size() >= batch_limit)
+                    {
+                        if(!send_message(sock, batch)) _exit(1);
+                        batch.resize(1);
+                    }
+                }
+                
+                if(steal && boost::filesystem::is_directory(it->symlink_status()) && 
+                        ((t.max_depth < 0) || (it.level() < t.max_depth)))
+                {
+                    struct stat st;
+                    if(!o.traversal.same_filesystem || 
+                            ((lstat(it->path().c_str(), &st) == 0) && (static_cast<std::uint64_t>(st.st_dev) == s.device)))
+                    {
+                        shard donated{it->path(), (s.depth + 1 + it.level()), s.device};
+                        if(!send_message(sock, shard_message(donate_message, donated))) _exit(1);
+                        it.no_push();
+                        steal = false;
+                    }
+                }
+            }
+        }
+        catch(const boost::filesystem::filesystem_error& e)
+        {
+            if((batch.size() > 1) && !send_message(sock, batch)) _exit(1);
+            batch.resize(1);
+            if(!send_message(sock, error_text(e.code(), e.path1(), e.what()))) _exit(1);
+        }
+        catch(const std::exception& e)
+        {
+            if((batch.size() > 1) && !send_message(sock, batch)) _exit(1);
+            batch.resize(1);
+            if(!send_message(sock, error_text(boost::system::error_code(), s.root, e.what()))) _exit(1);
+        }
+        if((batch.size() > 1) && !send_message(sock, batch)) _exit(1);
+    }
+    
+    /**
+     * @brief The worker process: walks shards until told to quit.
+     */
+    inline void worker_main(const int& sock, const filesystem::shard_options& o)
+    {
+        std::vector<char> incoming(max_message);
+        while(true)
+        {
+            ssize_t n(recv(sock, incoming.data(), incoming.size(), 0));
+            if((n == -1) && (errno == EINTR)) continue;
+            if(n <= 0) return;
+            
+            //a steal request that arrives after the shard is finished has nothing to take:
+            if(incoming[0] == quit_message) return;
+            if(incoming[0] != walk_message) continue;
+            
+            worker_walk(sock, parse_shard(incoming.data(), static_cast<std::size_t>(n)), o);
+            if(!send_message(sock, std::string(1, idle_message))) return;
+        }
+    }
+    
+    
+}
+
+//shard_options member functions:
+namespace filesystem
+{
+    shard_options::shard_options() : 
+            workers(std::max(1u, std::thread::hardware_concurrency())),
+            expression(),
+            exact_match(false),
+            traversal()
+    {
+    }
+    
+    
+}
+
+//sharded_glob member functions:
+namespace filesystem
+{
+    struct sharded_glob::state
+    {
+        struct worker
+        {
+            pid_t pid;
+            int sock;
+            bool busy;
+            
+            //true while a steal request to this worker is unanswered:
+            bool asked;
+        };
+        
+        /* An error that ended a worker's walk early. */
+        struct failure
+        {
+            std::int32_t code;
+            path where;
+            std::string what;
+        };
+        
+        state() : 
+                workers(),
+                queue(),
+                results(),
+                current(),
+                errors()
+        {
+        }
+        
+        ~state()
+        {
+            for(std::vector<worker>::iterator w(this->workers.begin()); w != this->workers.end(); ++w)
+            {
+                send_message(w->sock, std::string(1, quit_message));
+                close(w->sock);
+            }
+            for(std::vector<worker>::iterator w(this->workers.begin()); w != this->workers.end(); ++w)
+            {
+                while((waitpid(w->pid, nullptr, 0) == -1) && (errno == EINTR));
+            }
+        }
+        
+        /**
+         * @brief Forks a worker connected by a socket pair.
+         */
+        void spawn(const shard_options& o)
+        {
+            using boost::filesystem::filesystem_error;
+            using boost::system::error_code;
+            using boost::system::system_category;
+            
+            int sv[2];
+            if(socketpair(AF_UNIX, (SOCK_SEQPACKET | SOCK_CLOEXEC), 0, sv) == -1)
+            {
+                throw filesystem_error("Can not create worker socket!", error_code(errno, system_category()));
+            }
+            
+            pid_t pid(fork());
+            if(pid == -1)
+            {
+                int e(errno);
+                close(sv[0]);
+                close(sv[1]);
+                throw filesystem_error("Can not start worker!", error_code(e, system_category()));
+            }
+            if(pid == 0)
+            {
+                close(sv[0]);
+                for(std::vector<worker>::const_iterator w(this->workers.begin()); w != this->workers.end(); ++w)
+                {
+                    close(w->sock);
+                }
+                try
+                {
+                    //the parent's scheduler may have been locked by another thread when we forked:
+                    shard_options own(o);
+                    if(own.traversal.scheduler)
+                    {
+                        own.traversal.scheduler = std::make_shared<filesystem::io_scheduler>(own.traversal.scheduler->limits());
+                    }
+                    worker_main(sv[1], own);
+                }
+                catch(...)
+                {
+                    _exit(1);
+                }
+                _exit(0);
+            }
+            close(sv[1]);
+            this->workers.push_back(worker{pid, sv[0], false, false});
+        }
+        
+        /**
+         * @brief Hands queued shards to idle workers, and asks busy workers
+         * to give up work for the idle workers that are left.
+         */
+        void dispatch()
+        {
+            using boost::filesystem::filesystem_error;
+            using boost::system::error_code;
+            using boost::system::system_category;
+            
+            std::size_t idle(0);
+            for(std::vector<worker>::iterator w(this->workers.begin()); w != this->workers.end(); ++w)
+            {
+                if(w->busy) continue;
+                if(this->queue.empty())
+                {
+                    ++idle;
+                    continue;
+                }
+                if(!send_message(w->sock, shard_message(walk_message, this->queue.front())))
+                {
+                    throw filesystem_error("A shard worker died!", error_code(errno, system_category()));
+                }
+                w->busy = true;
+                this->queue.pop_front();
+            }
+            for(std::vector<worker>::iterator w(this->workers.begin()); 
+                    ((w != this->workers.end()) && (idle > 0)); ++w)
+            {
+                if(!w->busy || w->asked) continue;
+                if(send_message(w->sock, std::string(1, steal_message))) w->asked = true;
+                --idle;
+            }
+        }
+        
+        /**
+         * @brief Waits for messages from the workers and handles them.
+         */
+        void pump()
+        {
+            using boost::filesystem::filesystem_error;
+            using boost::system::error_code;
+            using boost::system::system_category;
+            
+            std::vector<pollfd> fds;
+            for(std::vector<worker>::const_iterator w(this->workers.begin()); w != this->workers.end(); ++w)
+            {
+                fds.push_back(pollfd{w->sock, POLLIN, 0});
+            }
+            if(poll(fds.data(), fds.size(), -1) == -1)
+            {
+                if(errno == EINTR) return;
+                throw filesystem_error("Can not wait for workers!", error_code(errno, system_category()));
+            }
+            
+            std::vector<char> incoming(max_message);
+            for(std::size_t x(0); x < fds.size(); ++x)
+            {
+                if(fds[x].revents == 0) continue;
+                worker& w(this->workers[x]);
+                ssize_t n(recv(w.sock, incoming.data(), incoming.size(), MSG_DONTWAIT));
+                if((n == -1) && ((errno == EAGAIN) || (errno == EINTR))) continue;
+                if(n <= 0)
+                {
+                    throw filesystem_error("A shard worker died!", error_code(((n == 0) ? ECONNRESET : errno), 
+                            system_category()));
+                }
+                
+                switch(incoming[0])
+                {
+                    case results_message:
+                    {
+                        const char* p(incoming.data() + 1);
+                        const char* e(incoming.data() + n);
+                        while(p < e)
+                        {
+                            boost::filesystem::file_type t(static_cast<boost::filesystem::file_type>(*p));
+                            const char* name(p + 1);
+                            p = std::find(name, e, '\0');
+                            
+                            boost::filesystem::file_status st(t);
+                            if(t == boost::filesystem::symlink_file) st = boost::filesystem::file_status();
+                            this->results.push_back(directory_entry(path(std::string(name, p)), st, 
+                                    boost::filesystem::file_status(t)));
+                            ++p;
+                        }
+                    }
+                    break;
+                    
+                    case donate_message:
+                    {
+                        this->queue.push_back(parse_shard(incoming.data(), static_cast<std::size_t>(n)));
+                        w.asked = false;
+                    }
+                    break;
+                    
+                    case idle_message:
+                    {
+                        w.busy = false;
+                        w.asked = false;
+                    }
+                    break;
+                    
+                    case error_message:
+                    {
+                        //kept for next() to throw once the matches sent before it are yielded:
+                        failure f;
+                        const char* name(incoming.data() + 1 + sizeof(f.code));
+                        const char* e(incoming.data() + n);
+                        const char* what(std::find(name, e, '\0'));
+                        std::memcpy(&f.code, (incoming.data() + 1), sizeof(f.code));
+                        f.where = std::string(name, what);
+                        f.what = std::string(std::min((what + 1), e), e);
+                        this->errors.push_back(f);
+                    }
+                    break;
+                    
+                    default:
+                    break;
+                }
+            }
+            this->dispatch();
+        }
+        
+        /**
+         * @return true if there is nothing left to do.
+         */
+        bool finished() const
+        {
+            if(!this->queue.empty()) return false;
+            for(std::vector<worker>::const_iterator w(this->workers.begin()); w != this->workers.end(); ++w)
+            {
+                if(w->busy) return false;
+            }
+            return true;
+        }
+        
+        /**
+         * @brief Moves to the next match.
+         * @return false once every shard is done and every match yielded.
+         */
+        bool next()
+        {
+            using boost::filesystem::filesystem_error;
+            using boost::system::system_category;
+            
+            while(this->results.empty() && this->errors.empty())
+            {
+                if(this->finished()) return false;
+                this->pump();
+            }
+            if(this->results.empty())
+            {
+                //a walk that ended early; the other shards carry on if the caller does:
+                const failure f(this->errors.front());
+                this->errors.pop_front();
+                if(f.code != 0)
+                {
+                    throw filesystem_error("A shard worker could not finish walking a directory!", f.where, 
+                            boost::system::error_code(f.code, system_category()));
+                }
+                throw filesystem_error(("A shard worker failed: " + f.what), f.where, boost::system::error_code());
+            }
+            this->current = this->results.front();
+            this->results.pop_front();
+            return true;
+        }
+        
+        std::vector<worker> workers;
+        std::deque<shard> queue;
+        std::deque<directory_entry> results;
+        directory_entry current;
+        
+        //errors the workers reported, until next() throws them:
+        std::deque<failure> errors;
+    };
+    
+    sharded_glob::sharded_glob() : 
+            impl()
+    {
+    }
+    
+    /**
+     * @brief Starts the workers and positions the iterator at the first match.
+     * @param p The root folder.
+     * @param o The settings.
+     */
+    sharded_glob::sharded_glob(const path& p, const shard_options& o) : 
+            impl(new state())
+    {
+        using boost::filesystem::filesystem_error;
+        using boost::system::error_code;
+        using boost::system::system_category;
+        
+        struct stat st;
+        if(stat(p.c_str(), &st) == -1) throw filesystem_error("Can not open directory!", p, error_code(errno, system_category()));
+        if(!S_ISDIR(st.st_mode)) throw filesystem_error("Can not open directory!", p, error_code(ENOTDIR, system_category()));
+        
+        for(unsigned int x(0); x < std::max(1u, o.workers); ++x) this->impl->spawn(o);
+        
+        //everything starts as one shard; stealing spreads it over the other workers:
+        this->impl->queue.push_back(shard{p, -1, static_cast<std::uint64_t>(st.st_dev)});
+        this->impl->dispatch();
+        if(!this->impl->next()) this->impl.reset();
+    }
+    
+    sharded_glob::sharded_glob(const sharded_glob& g) : 
+            impl(g.impl)
+    {
+    }
+    
+    sharded_glob::~sharded_glob()
+    {
+    }
+    
+    sharded_glob& sharded_glob::operator=(const sharded_glob& g)
+    {
+        if(this != &g)
+        {
+            this->impl = g.impl;
+        }
+        return *this;
+    }
+    
+    sharded_glob& sharded_glob::operator++()
+    {
+        if(this->end()) return *this;
+        if(!this->impl->next()) this->impl.reset();
+        return *this;
+    }
+    
+    sharded_glob sharded_glob::operator++(int)
+    {
+        sharded_glob tempg(*this);
+        ++(*this);
+        return tempg;
+    }
+    
+    bool sharded_glob::operator!=(const sharded_glob& g) const
+    {
+        return (this->impl != g.impl);
+    }
+    
+    bool sharded_glob::operator==(const sharded_glob& g) const
+    {
+        return (this->impl == g.impl);
+    }
+    
+    directory_entry& sharded_glob::operator*()
+    {
+        return this->impl->current;
+    }
+    
+    directory_entry* sharded_glob::operator->()
+    {
+        return &(this->impl->current);
+    }
+    
+    void sharded_glob::swap(sharded_glob& g)
+    {
+        sharded_glob tempg(g);
+        g = (*this);
+        (*this) = tempg;
+    }
+    
+    /**
+     * @return true if at end.
+     */
+    bool sharded_glob::end() const
+    {
+        return !(this->impl);
+    }
+    
+    
+}
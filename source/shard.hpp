@@ -0,0 +1,94 @@
+#ifndef UTILITY_SHARD_HPP_INCLUDED
+#define UTILITY_SHARD_HPP_INCLUDED
+#include <boost/filesystem.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "filesystem.hpp"
+
+namespace filesystem
+{
+    struct shard_options;
+    class sharded_glob;
+    
+    
+    /**
+     * @struct shard_options
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file shard.hpp
+     * @brief Settings for a sharded_glob.
+     */
+    struct shard_options
+    {
+        explicit shard_options();
+        
+        /* The number of worker processes.  Defaults to the number of CPUs. */
+        unsigned int workers;
+        
+        /* The regex entries are matched against, with the same meaning as for
+         * recursive_glob.  An empty expression matches everything. */
+        std::string expression;
+        bool exact_match;
+        
+        /* Applied by each worker.  max_depth counts from the real root, not
+         * from the worker's shard. */
+        traversal_options traversal;
+    };
+    
+    /**
+     * @class sharded_glob
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file shard.hpp
+     * @brief A recursive glob spread over several worker processes, for trees
+     * too large to walk in one.  The iterator is the coordinator: it forks the
+     * workers, hands them subtrees over Unix domain sockets, lets idle workers
+     * take unexplored directories from busy ones, and yields the matches they
+     * send back as they arrive.  Entries are not in recursive_iterator order.
+     * Copies share their position.  An unreadable shard root is skipped; any
+     * other error that ends a worker's walk early is thrown as a 
+     * filesystem_error once the matches sent before it have been yielded,
+     * and iterating further carries on with the other shards.
+     * 
+     * The workers are forked without exec, so only the thread that 
+     * constructs the iterator exists in them.  Construct it while no other
+     * thread of the process can be holding a lock the workers need: in 
+     * practice, before starting threads, or while none (including this 
+     * library's prefetch_iterator, content_search, parallel copies and
+     * io_pool) are running.  glibc keeps malloc usable in the workers;
+     * anything else locked at the moment of the fork stays locked there.
+     */
+    class sharded_glob
+    {
+    public:
+        explicit sharded_glob();
+        sharded_glob(const boost::filesystem::path&, const shard_options& = shard_options());
+        sharded_glob(const sharded_glob&);
+        
+        virtual ~sharded_glob();
+        
+        virtual sharded_glob& operator=(const sharded_glob&);
+        virtual sharded_glob& operator++();
+        sharded_glob operator++(int);
+        
+        bool operator!=(const sharded_glob&) const;
+        bool operator==(const sharded_glob&) const;
+        
+        boost::filesystem::directory_entry& operator*();
+        boost::filesystem::directory_entry* operator->();
+        void swap(sharded_glob&);
+        
+        bool end() const;
+        
+    private:
+        struct state;
+        
+        std::shared_ptr<state> impl;
+    };
+    
+    
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef UTILITY_SPSC_RING_HPP_INCLUDED
+#define UTILITY_SPSC_RING_HPP_INCLUDED
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace filesystem
+{
+    template<typename type> class spsc_ring;
+    
+    
+    /**
+     * @class spsc_ring
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file spsc_ring.hpp
+     * @brief A bounded, lock-free ring buffer for exactly one producer thread
+     * and exactly one consumer thread.  Neither side ever blocks; push() and pop()
+     * simply fail when the ring is full or empty.
+     */
+    template<typename type>
+    class spsc_ring
+    {
+    public:
+        explicit spsc_ring(const std::size_t&);
+        
+        spsc_ring(const spsc_ring&) = delete;
+        spsc_ring& operator=(const spsc_ring&) = delete;
+        
+        bool push(type&&);
+        bool pop(type&);
+        
+        std::size_t capacity() const;
+        
+    private:
+        std::vector<type> slots;
+        std::size_t mask;
+        
+        //kept on separate cache lines so the two threads don't fight over them:
+        alignas(64) std::atomic<std::size_t> head;
+        alignas(64) std::atomic<std::size_t> tail;
+    };
+    
+    /**
+     * @param c The minimum number of elements the ring can hold.  Rounded
+     * up to a power of two.
+     */
+    template<typename type>
+    spsc_ring<type>::spsc_ring(const std::size_t& c) : 
+            slots(),
+            mask(0),
+            head(0),
+            tail(0)
+    {
+        std::size_t size(2);
+        while(size < c) size <<= 1;
+        this->slots.resize(size);
+        this->mask = (size - 1);
+    }
+    
+    /**
+     * @brief Producer side.
+     * @return false if the ring is full.  The element is left untouched.
+     */
+    template<typename type>
+    bool spsc_ring<type>::push(type&& t)
+    {
+        const std::size_t back(this->tail.load(std::memory_order_relaxed));
+        if((back - this->head.load(std::memory_order_acquire)) == this->slots.size()) return false;
+        this->slots[back & this->mask] = std::move(t);
+        this->tail.store((back + 1), std::memory_order_release);
+        return true;
+    }
+    
+    /**
+     * @brief Consumer side.
+     * @return false if the ring is empty.
+     */
+    template<typename type>
+    bool spsc_ring<type>::pop(type& t)
+    {
+        const std::size_t front(this->head.load(std::memory_order_relaxed));
+        if(front == this->tail.load(std::memory_order_acquire)) return false;
+        t = std::move(this->slots[front & this->mask]);
+        this->head.store((front + 1), std::memory_order_release);
+        return true;
+    }
+    
+    template<typename type>
+    std::size_t spsc_ring<type>::capacity() const
+    {
+        return this->slots.size();
+    }
+    
+    
+}
+
+#endif
@@ -0,0 +1,453 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <boost/filesystem.hpp>
+
+#include "tar_writer.hpp"
+
+using boost::filesystem::path;
+
+namespace
+{
+    const std::size_t block_size(512);
+    
+    //archives are padded to a multiple of this, like tar's default blocking factor of 20:
+    const std::size_t record_size(20 * block_size);
+    
+    const std::size_t copy_chunk(64 * 1024);
+    
+    void throw_errno(const std::string&, const path&, const int&);
+    bool put_octal(char*, const std::size_t&, std::uintmax_t);
+    bool split_name(const std::string&, std::string&, std::string&);
+    std::string pax_record(const std::string&, const std::string&);
+    
+    
+    inline void throw_errno(const std::string& message, const path& p, const int& e)
+    {
+        using boost::filesystem::filesystem_error;
+        using boost::system::error_code;
+        using boost::system::system_category;
+        
+        throw filesystem_error(message, p, error_code(e, system_category()));
+    }
+    
+    /**
+     * @brief Writes a zero padded, NUL terminated octal number into a header
+     * field.
+     * @return false if it does not fit.
+     */
+    inline bool put_octal(char* field, const std::size_t& width, std::uintmax_t v)
+    {
+        field[width - 1] = '\0';
+        for(std::size_t x(width - 1); x > 0; --x)
+        {
+            field[x - 1] = static_cast<char>('0' + (v & 7));
+            v >>= 3;
+        }
+        return (v == 0);
+    }
+    
+    /**
+     * @brief Splits a name into ustar's prefix and name fields.
+     * @return false if it can not be split to fit.
+     */
+    inline bool split_name(const std::string& full, std::string& prefix, std::string& name)
+    {
+        prefix.clear();
+        name = full;
+        if(full.size() <= 100) return true;
+        if(full.size() > 256) return false;
+        
+        //the name field gets everything after the first '/' that leaves it short enough:
+        const std::string::size_type slash(full.find('/', (full.size() - 101)));
+        if((slash == std::string::npos) || (slash == 0) || (slash > 155) || (slash == (full.size() - 1))) return false;
+        prefix = full.substr(0, slash);
+        name = full.substr(slash + 1);
+        return true;
+    }
+    
+    /**
+     * @return A pax extended header record: "<length> <key>=<value>\n", where
+     * the length counts itself.
+     */
+    inline std::string pax_record(const std::string& key, const std::string& value)
+    {
+        const std::size_t rest(key.size() + value.size() + 3);
+        std::size_t length(rest + 1);
+        while((rest + std::to_string(length).size()) != length) ++length;
+        return (std::to_string(length) + " " + key + "=" + value + "\n");
+    }
+    
+    
+}
+
+namespace filesystem
+{
+    const unsigned int tar_writer::needed_fields(file_metadata::type_field | file_metadata::mode_field | 
+            file_metadata::size_field | file_metadata::mtime_field | file_metadata::owner_field | 
+            file_metadata::inode_field);
+    
+    /**
+     * @param fd Where the archive is written.  It is not closed.
+     * @param r Entries are named relative to this directory.  Entries outside
+     * of it, or all entries if it is empty, are named by their full path 
+     * without the leading '/'.
+     */
+    tar_writer::tar_writer(const int& fd, const path& r) : 
+            out(fd),
+            root(r.string()),
+            pending(),
+            total(0),
+            finished(false),
+            links()
+    {
+        while((this->root.size() > 1) && (this->root.back() == '/')) this->root.pop_back();
+    }
+    
+    tar_writer::~tar_writer()
+    {
+        if(!this->finished)
+        {
+            try
+            {
+                this->finish();
+            }
+            catch(...)
+            {
+            }
+        }
+    }
+    
+    /**
+     * @brief Archives the current entry of a traversal, reusing the metadata
+     * it has already gathered.
+     */
+    void tar_writer::write(recursive_iterator& it)
+    {
+        this->write(it->path(), it.metadata(tar_writer::needed_fields));
+    }
+    
+    /**
+     * @brief Archives one entry.
+     * @param p The entry.
+     * @param md What is already known about it.  Anything else it needs is
+     * read with a stat.
+     */
+    void tar_writer::write(const path& p, file_metadata md)
+    {
+        if((md.valid & tar_writer::needed_fields) != tar_writer::needed_fields)
+        {
+            if(!stat_entry(AT_FDCWD, p.c_str(), md, (tar_writer::needed_fields & ~md.valid)))
+            {
+                throw_errno("Can not archive!", p, errno);
+            }
+        }
+        
+        std::string name(p.string());
+        if(!this->root.empty() && (name.compare(0, this->root.size(), this->root) == 0) && 
+                ((name.size() == this->root.size()) || (name[this->root.size()] == '/') || (this->root == "/")))
+        {
+            name.erase(0, this->root.size());
+        }
+        name.erase(0, name.find_first_not_of('/'));
+        if(name.empty()) name = ".";
+        
+        switch(md.type)
+        {
+            case boost::filesystem::regular_file:
+            {
+                const std::pair<std::uintmax_t, std::uintmax_t> key(md.device, md.inode);
+                if(md.links > 1)
+                {
+                    auto l(this->links.find(key));
+                    if(l != this->links.end())
+                    {
+                        this->header(name, md, '1', l->second, 0);
+                        break;
+                    }
+                }
+                
+                //open it first, so an entry that has vanished leaves nothing behind:
+                int fd(::open(p.c_str(), (O_RDONLY | O_NOFOLLOW | O_CLOEXEC)));
+                if(fd == -1) throw_errno("Can not archive!", p, errno);
+                try
+                {
+                    this->header(name, md, '0', std::string(), md.size);
+                    this->data(p, fd, md.size);
+                }
+                catch(...)
+                {
+                    ::close(fd);
+                    throw;
+                }
+                ::close(fd);
+                
+                //only an archived copy can be the target of later hard links:
+                if(md.links > 1) this->links.emplace(key, name);
+            }
+            break;
+            
+            case boost::filesystem::directory_file:
+            {
+                if(name.back() != '/') name += '/';
+                this->header(name, md, '5', std::string(), 0);
+            }
+            break;
+            
+            case boost::filesystem::symlink_file:
+            {
+                //a link replaced by a longer one since it was stat'ed fills the buffer; try again with more room:
+                std::string target(std::max<std::uintmax_t>(md.size, 1) + 1, '\0');
+                ssize_t n(-1);
+                while((n = readlink(p.c_str(), &target[0], target.size())) == static_cast<ssize_t>(target.size()))
+                {
+                    target.resize(target.size() * 2);
+                }
+                if(n == -1) throw_errno("Can not archive!", p, errno);
+                target.resize(static_cast<std::size_t>(n));
+                this->header(name, md, '2', target, 0);
+            }
+            break;
+            
+            case boost::filesystem::character_file:
+            case boost::filesystem::block_file:
+            case boost::filesystem::fifo_file:
+            {
+                this->header(name, md, ((md.type == boost::filesystem::character_file) ? '3' : 
+                        ((md.type == boost::filesystem::block_file) ? '4' : '6')), std::string(), 0);
+            }
+            break;
+            
+            default:
+            break;
+        }
+        if(this->pending.size() >= copy_chunk) this->flush();
+    }
+    
+    /**
+     * @brief Ends the archive.  Nothing may be written after this.
+     */
+    void tar_writer::finish()
+    {
+        if(this->finished) return;
+        this->finished = true;
+        this->pending.append((2 * block_size), '\0');
+        this->total += (2 * block_size);
+        if((this->total % record_size) != 0)
+        {
+            const std::size_t fill(record_size - (this->total % record_size));
+            this->pending.append(fill, '\0');
+            this->total += fill;
+        }
+        this->flush();
+    }
+    
+    /**
+     * @brief Queues the header of an entry, preceded by a pax header if any of
+     * its fields do not fit in ustar.
+     * @param link The link target for hard and symbolic links.
+     */
+    void tar_writer::header(const std::string& name, const file_metadata& md, const char& type, 
+            const std::string& link, const std::uintmax_t& size)
+    {
+        char h[block_size];
+        std::memset(h, 0, block_size);
+        std::string pax;
+        
+        std::string prefix, short_name;
+        if(!split_name(name, prefix, short_name))
+        {
+            pax += pax_record("path", name);
+            prefix.clear();
+            short_name = name.substr(0, 100);
+        }
+        std::memcpy(h, short_name.data(), short_name.size());
+        std::memcpy((h + 345), prefix.data(), prefix.size());
+        
+        put_octal((h + 100), 8, (md.mode & 07777));
+        if(!put_octal((h + 108), 8, md.uid))
+        {
+            pax += pax_record("uid", std::to_string(md.uid));
+            put_octal((h + 108), 8, 0);
+        }
+        if(!put_octal((h + 116), 8, md.gid))
+        {
+            pax += pax_record("gid", std::to_string(md.gid));
+            put_octal((h + 116), 8, 0);
+        }
+        if(!put_octal((h + 124), 12, size))
+        {
+            pax += pax_record("size", std::to_string(size));
+            put_octal((h + 124), 12, 0);
+        }
+        //ustar has no times before 1970; pax does:
+        const std::uintmax_t mtime((md.mtime > 0) ? static_cast<std::uintmax_t>(md.mtime) : 0);
+        if((md.mtime < 0) || !put_octal((h + 136), 12, mtime))
+        {
+            pax += pax_record("mtime", std::to_string(md.mtime));
+            put_octal((h + 136), 12, 0);
+        }
+        h[156] = type;
+        
+        if((type == '1') || (type == '2'))
+        {
+            if(link.size() > 100) pax += pax_record("linkpath", link);
+            std::memcpy((h + 157), link.data(), std::min<std::size_t>(link.size(), 100));
+        }
+        std::memcpy((h + 257), "ustar", 6);
+        std::memcpy((h + 263), "00", 2);
+        if((type == '3') || (type == '4'))
+        {
+            put_octal((h + 329), 8, major(md.rdev));
+            put_octal((h + 337), 8, minor(md.rdev));
+        }
+        
+        //the checksum is computed with its own field full of spaces:
+        std::memset((h + 148), ' ', 8);
+        unsigned int sum(0);
+        for(std::size_t x(0); x < block_size; ++x) sum += static_cast<unsigned char>(h[x]);
+        put_octal((h + 148), 7, sum);
+        h[155] = ' ';
+        
+        if(!pax.empty()) this->pax_header(name, pax);
+        this->pending.append(h, block_size);
+        this->total += block_size;
+    }
+    
+    /**
+     * @brief Queues a pax extended header for the entry that follows it.
+     */
+    void tar_writer::pax_header(const std::string& name, const std::string& records)
+    {
+        file_metadata md;
+        md.mode = 0644;
+        md.uid = 0;
+        md.gid = 0;
+        md.mtime = 0;
+        
+        std::string base(name);
+        while(!base.empty() && (base.back() == '/')) base.pop_back();
+        base = base.substr(base.find_last_of('/') + 1);
+        this->header(("PaxHeaders/" + base).substr(0, 100), md, 'x', std::string(), records.size());
+        this->pending += records;
+        this->total += records.size();
+        this->pad();
+    }
+    
+    /**
+     * @brief Writes exactly "size" bytes of a file's data after its header.  If
+     * the file shrank since it was stat'ed, the rest is zeros; if it grew, the
+     * rest is left out.  If it can not be read, the rest is zeros as well,
+     * so later entries stay where the header said they would be, and then
+     * the error is thrown.
+     */
+    void tar_writer::data(const path& p, const int& fd, const std::uintmax_t& size)
+    {
+        this->flush();
+        
+        std::uintmax_t sent(0);
+        try
+        {
+            bool use_sendfile(true);
+            std::string buffer;
+            while(sent < size)
+            {
+                const std::size_t want(static_cast<std::size_t>(std::min<std::uintmax_t>((size - sent), (1 << 30))));
+                ssize_t n(-1);
+                if(use_sendfile)
+                {
+                    n = sendfile(this->out, fd, nullptr, want);
+                    if((n == -1) && ((errno == EINVAL) || (errno == ENOSYS)))
+                    {
+                        //sendfile can not read from this file; copy it the slow way:
+                        use_sendfile = false;
+                        buffer.resize(copy_chunk);
+                        continue;
+                    }
+                    if((n == -1) && (errno == EINTR)) continue;
+                    if(n == -1) throw_errno("Can not archive!", p, errno);
+                }
+                else
+                {
+                    n = ::read(fd, &buffer[0], std::min(want, buffer.size()));
+                    if((n == -1) && (errno == EINTR)) continue;
+                    if(n == -1) throw_errno("Can not archive!", p, errno);
+                    this->pending.assign(buffer.data(), static_cast<std::size_t>(n));
+                    this->flush();
+                }
+                if(n == 0) break;
+                sent += static_cast<std::uintmax_t>(n);
+            }
+        }
+        catch(...)
+        {
+            //if the archive itself can not be written, there is nothing to keep in line:
+            try
+            {
+                this->zeros(size - sent);
+                this->total += size;
+                this->pad();
+                this->flush();
+            }
+            catch(...)
+            {
+            }
+            throw;
+        }
+        this->zeros(size - sent);
+        this->total += size;
+        this->pad();
+    }
+    
+    /**
+     * @brief Writes "count" zeros, however many, a chunk at a time.
+     */
+    void tar_writer::zeros(std::uintmax_t count)
+    {
+        while(count > 0)
+        {
+            const std::size_t fill(static_cast<std::size_t>(std::min<std::uintmax_t>(count, copy_chunk)));
+            this->pending.assign(fill, '\0');
+            this->flush();
+            count -= fill;
+        }
+    }
+    
+    /**
+     * @brief Pads the archive to a whole block.
+     */
+    void tar_writer::pad()
+    {
+        if((this->total % block_size) != 0)
+        {
+            const std::size_t fill(block_size - (this->total % block_size));
+            this->pending.append(fill, '\0');
+            this->total += fill;
+        }
+    }
+    
+    void tar_writer::flush()
+    {
+        std::size_t written(0);
+        while(written < this->pending.size())
+        {
+            ssize_t n(::write(this->out, (this->pending.data() + written), (this->pending.size() - written)));
+            if(n == -1)
+            {
+                if(errno == EINTR) continue;
+                throw_errno("Can not write archive!", path(), errno);
+            }
+            written += static_cast<std::size_t>(n);
+        }
+        this->pending.clear();
+    }
+    
+    
+}
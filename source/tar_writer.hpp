@@ -0,0 +1,62 @@
+#ifndef UTILITY_TAR_WRITER_HPP_INCLUDED
+#define UTILITY_TAR_WRITER_HPP_INCLUDED
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "filesystem.hpp"
+
+namespace filesystem
+{
+    class tar_writer;
+    
+    
+    /**
+     * @class tar_writer
+     * @author Jonathan Whitlock
+     * @date 10/19/2026
+     * @file tar_writer.hpp
+     * @brief Writes a POSIX tar archive (ustar, with pax headers for what
+     * ustar can not hold) to a file descriptor.  Entries come straight from a 
+     * traversal, reusing the metadata it already gathered, and file data is 
+     * moved with sendfile so it never passes through user space.  Files seen
+     * before under another name (same device and inode) are stored as hard
+     * links.  Sockets are skipped.
+     */
+    class tar_writer
+    {
+    public:
+        tar_writer(const int&, const boost::filesystem::path& = boost::filesystem::path());
+        ~tar_writer();
+        
+        tar_writer(const tar_writer&) = delete;
+        tar_writer& operator=(const tar_writer&) = delete;
+        
+        void write(const boost::filesystem::path&, file_metadata = file_metadata());
+        void write(recursive_iterator&);
+        void finish();
+        
+        static const unsigned int needed_fields;
+        
+    private:
+        void header(const std::string&, const file_metadata&, const char&, const std::string&, const std::uintmax_t&);
+        void pax_header(const std::string&, const std::string&);
+        void data(const boost::filesystem::path&, const int&, const std::uintmax_t&);
+        void zeros(std::uintmax_t);
+        void pad();
+        void flush();
+        
+        int out;
+        std::string root;
+        std::string pending;
+        std::uintmax_t total;
+        bool finished;
+        std::map<std::pair<std::uintmax_t, std::uintmax_t>, std::string> links;
+    };
+    
+    
+}
+
+#endif
@@ -0,0 +1,223 @@
+#ifdef UNIT_TEST_PROG
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include "async_walk.hpp"
+
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filesystem.hpp"
+#include "async.hpp"
+
+namespace
+{
+    struct task;
+    
+    boost::filesystem::path make_tree();
+    std::set<std::string> relative_paths(const boost::filesystem::path&);
+    task walk(filesystem::async_walk, std::set<std::string>&, std::promise<void>&);
+    task copy(filesystem::async_copy, std::uintmax_t&, std::promise<void>&);
+    
+    
+    /**
+     * @brief A coroutine that starts right away and nobody waits on.
+     */
+    struct task
+    {
+        struct promise_type
+        {
+            task get_return_object()
+            {
+                return task();
+            }
+            
+            std::suspend_never initial_suspend() const
+            {
+                return std::suspend_never();
+            }
+            
+            std::suspend_never final_suspend() const noexcept
+            {
+                return std::suspend_never();
+            }
+            
+            void return_void() const
+            {
+            }
+            
+            void unhandled_exception() const
+            {
+                std::terminate();
+            }
+        };
+    };
+    
+    /**
+     * @return A new folder with a few files in a few folders.
+     */
+    inline boost::filesystem::path make_tree()
+    {
+        using boost::filesystem::path;
+        
+        const path root(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path());
+        for(unsigned int x(0); x < 10; ++x)
+        {
+            const path folder(root / ("folder" + std::to_string(x)) / "nested");
+            boost::filesystem::create_directories(folder);
+            for(unsigned int y(0); y < 30; ++y)
+            {
+                std::ofstream((folder / ("file" + std::to_string(y))).string().c_str())<< "data " << x << ' ' << y;
+            }
+        }
+        return root;
+    }
+    
+    /**
+     * @return Everything under root, relative to root.
+     */
+    inline std::set<std::string> relative_paths(const boost::filesystem::path& root)
+    {
+        std::set<std::string> paths;
+        for(filesystem::recursive_iterator it(root); !it.end(); ++it)
+        {
+            paths.insert(it->path().string().substr(root.string().size()));
+        }
+        return paths;
+    }
+    
+    inline task walk(filesystem::async_walk w, std::set<std::string>& paths, std::promise<void>& done)
+    {
+        while(std::optional<boost::filesystem::directory_entry> entry = co_await w.next())
+        {
+            paths.insert(entry->path().string());
+        }
+        done.set_value();
+    }
+    
+    inline task copy(filesystem::async_copy c, std::uintmax_t& copied, std::promise<void>& done)
+    {
+        copied = co_await c;
+        done.set_value();
+    }
+    
+    
+}
+
+namespace test
+{
+    /**
+     * @return true if several walks sharing a two thread pool, in small
+     * batches, each see what recursive_iterator sees.
+     */
+    bool async_walks()
+    {
+        using boost::filesystem::path;
+        
+        const path root(make_tree());
+        std::set<std::string> expected;
+        for(filesystem::recursive_iterator it(root); !it.end(); ++it) expected.insert(it->path().string());
+        
+        filesystem::async_options options;
+        options.pool = std::make_shared<filesystem::io_pool>(2);
+        options.batch = 7;
+        
+        std::vector<std::set<std::string> > found(8);
+        std::vector<std::promise<void> > done(found.size());
+        for(std::size_t x(0); x < found.size(); ++x)
+        {
+            if(x % 2) walk(filesystem::async_walk(root, filesystem::traversal_options(), options), found[x], done[x]);
+            else walk(filesystem::async_walk(filesystem::recursive_iterator(root), options), found[x], done[x]);
+        }
+        
+        bool success(true);
+        for(std::size_t x(0); x < found.size(); ++x)
+        {
+            done[x].get_future().wait();
+            success = (success && (found[x] == expected));
+        }
+        boost::filesystem::remove_all(root);
+        return success;
+    }
+    
+    /**
+     * @return true if two awaited copies sharing one pool thread, in small
+     * batches, each copy everything and count what they copied.
+     */
+    bool async_copies()
+    {
+        using boost::filesystem::path;
+        
+        const path from(make_tree());
+        const std::set<std::string> expected(relative_paths(from));
+        
+        filesystem::async_options options;
+        options.pool = std::make_shared<filesystem::io_pool>(1);
+        options.batch = 7;
+        
+        std::vector<path> to(2);
+        std::vector<std::uintmax_t> copied(to.size(), 0);
+        std::vector<std::promise<void> > done(to.size());
+        for(std::size_t x(0); x < to.size(); ++x)
+        {
+            to[x] = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path());
+            boost::filesystem::create_directories(to[x]);
+            copy(filesystem::async_copy(from, to[x], filesystem::copy_options(), filesystem::traversal_options(), options), 
+                    copied[x], done[x]);
+        }
+        
+        //each folder is copied into "to", under its own name:
+        bool success(true);
+        for(std::size_t x(0); x < to.size(); ++x)
+        {
+            done[x].get_future().wait();
+            success = (success && (copied[x] == expected.size()) && (relative_paths(to[x] / from.filename()) == expected));
+            boost::filesystem::remove_all(to[x]);
+        }
+        boost::filesystem::remove_all(from);
+        return success;
+    }
+    
+    /**
+     * @return true if a pool whose last reference is dropped by one of its
+     * own jobs shuts down without waiting on the thread running that job.
+     */
+    bool pool_release()
+    {
+        std::shared_ptr<filesystem::io_pool> pool(std::make_shared<filesystem::io_pool>(2));
+        const std::weak_ptr<filesystem::io_pool> watch(pool);
+        std::promise<void> released;
+        const std::shared_future<void> wait(released.get_future());
+        
+        //the job holds the last reference once it is released here:
+        pool->post([pool, wait]()
+                {
+                    wait.wait();
+                });
+        pool.reset();
+        released.set_value();
+        
+        const std::chrono::steady_clock::time_point limit(std::chrono::steady_clock::now() + std::chrono::seconds(5));
+        while(!watch.expired() && (std::chrono::steady_clock::now() < limit))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        
+        //the destructor runs right after the last reference goes; joining its own thread would terminate:
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return watch.expired();
+    }
+    
+    
+}
+
+#endif
+#endif
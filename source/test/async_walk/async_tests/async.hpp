@@ -0,0 +1,13 @@
+#ifdef UNIT_TEST_PROG
+#ifndef ASYNC_TESTS_ASYNC_HPP_INCLUDED
+#define ASYNC_TESTS_ASYNC_HPP_INCLUDED
+
+namespace test
+{
+    bool async_walks();
+    bool async_copies();
+    bool pool_release();
+}
+
+#endif
+#endif
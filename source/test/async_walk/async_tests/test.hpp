@@ -0,0 +1,29 @@
+#ifdef UNIT_TEST_PROG
+#ifndef ASYNC_TESTS_TEST_HPP_INCLUDED
+#define ASYNC_TESTS_TEST_HPP_INCLUDED
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <unittest++/UnitTest++.h>
+
+#include "async.hpp"
+
+TEST(async_walk_test)
+{
+    bool success(test::async_walks());
+    CHECK(success);
+}
+
+TEST(async_copy_test)
+{
+    bool success(test::async_copies());
+    CHECK(success);
+}
+
+TEST(io_pool_release_test)
+{
+    bool success(test::pool_release());
+    CHECK(success);
+}
+
+#endif
+#endif
+#endif
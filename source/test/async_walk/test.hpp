@@ -0,0 +1,8 @@
+#ifdef UNIT_TEST_PROG
+#ifndef ASYNC_WALK_TEST_HPP_INCLUDED
+#define ASYNC_WALK_TEST_HPP_INCLUDED
+
+#include "test/async_walk/async_tests/test.hpp"
+
+#endif
+#endif
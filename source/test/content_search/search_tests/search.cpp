@@ -0,0 +1,158 @@
+#ifdef UNIT_TEST_PROG
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <set>
+#include <string>
+#include <tuple>
+
+#include "filesystem.hpp"
+#include "content_search.hpp"
+#include "literal_scan.hpp"
+#include "search.hpp"
+
+namespace
+{
+    typedef std::set<std::tuple<std::string, std::uintmax_t, std::uintmax_t, std::string> > hit_set;
+    
+    boost::filesystem::path make_logs();
+    hit_set run(const boost::filesystem::path&, const std::string&, const bool&);
+    
+    
+    /**
+     * @return A new folder with two logs to search, and a file that is not a log.
+     */
+    inline boost::filesystem::path make_logs()
+    {
+        using boost::filesystem::path;
+        
+        const path root(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path());
+        boost::filesystem::create_directories(root / "nested");
+        std::ofstream((root / "a.log").string().c_str(), std::ios::binary)<< 
+                "starting up\nERROR: disk 3 failed\nok\nERROR: disk 12 failed";
+        std::ofstream((root / "nested" / "b.log").string().c_str(), std::ios::binary)<< 
+                "ERROR: ERROR: twice\n\nno errors here\n";
+        std::ofstream((root / "notes.txt").string().c_str(), std::ios::binary)<< "ERROR: not a log\n";
+        return root;
+    }
+    
+    /**
+     * @return Every hit for the pattern in the *.log files under root, by
+     * file name, line, offset and text.
+     */
+    inline hit_set run(const boost::filesystem::path& root, const std::string& pattern, const bool& literal)
+    {
+        filesystem::search_options options;
+        options.pattern = pattern;
+        options.literal = literal;
+        options.threads = 2;
+        
+        hit_set hits;
+        for(filesystem::content_search it(filesystem::recursive_glob(root, ".*\\.log", true), options); !it.end(); ++it)
+        {
+            hits.insert(std::make_tuple(it->path.filename().string(), it->line, it->offset, it->text));
+        }
+        return hits;
+    }
+    
+    
+}
+
+namespace test
+{
+    /**
+     * @return true if a literal search finds each matching line once, with
+     * the offset of its first match.
+     */
+    bool literal_search()
+    {
+        const boost::filesystem::path root(make_logs());
+        const hit_set hits(run(root, "ERROR: ", true));
+        boost::filesystem::remove_all(root);
+        
+        const hit_set expected{
+            std::make_tuple("a.log", 2, 12, "ERROR: disk 3 failed"),
+            std::make_tuple("a.log", 4, 36, "ERROR: disk 12 failed"),
+            std::make_tuple("b.log", 1, 0, "ERROR: ERROR: twice")};
+        return (hits == expected);
+    }
+    
+    /**
+     * @return true if a regex search only reports lines the whole regex
+     * matches, not just the literal it contains.
+     */
+    bool regex_search()
+    {
+        const boost::filesystem::path root(make_logs());
+        const hit_set hits(run(root, "disk \\d\\d failed$", false));
+        const hit_set all(run(root, "^$|starting", false));
+        boost::filesystem::remove_all(root);
+        
+        const hit_set expected{std::make_tuple("a.log", 4, 43, "ERROR: disk 12 failed")};
+        const hit_set expected_all{
+            std::make_tuple("a.log", 1, 0, "starting up"),
+            std::make_tuple("b.log", 2, 20, "")};
+        return ((hits == expected) && (all == expected_all));
+    }
+    
+    /**
+     * @return true if the literal taken from a regex leaves out the arguments
+     * of its escapes and its escaped assertions, so lines spelled differently
+     * from the pattern are still found.
+     */
+    bool escaped_regex_search()
+    {
+        using filesystem::required_literal;
+        
+        const boost::filesystem::path root(make_logs());
+        const hit_set hits(run(root, "\\x45RROR: disk 1", false));
+        const hit_set words(run(root, "\\<twice\\>", false));
+        boost::filesystem::remove_all(root);
+        
+        const hit_set expected{std::make_tuple("a.log", 4, 36, "ERROR: disk 12 failed")};
+        const hit_set expected_words{std::make_tuple("b.log", 1, 14, "ERROR: ERROR: twice")};
+        return ((hits == expected) && (words == expected_words) && 
+                (required_literal("\\<error\\>") == "error") && 
+                (required_literal("\\`start\\'") == "start") && 
+                (required_literal("\\x41BC") == "BC") && 
+                (required_literal("\\x{41}BC") == "BC") && 
+                (required_literal("\\cAxyz") == "xyz") && 
+                (required_literal("(foo)\\k<foo>") == "") && 
+                (required_literal("(foo)\\k'foo'") == "") && 
+                (required_literal("(a)\\g{1}xy") == "xy") && 
+                (required_literal("(a)\\g12") == "") && 
+                (required_literal("\\0101q") == "q") && 
+                (required_literal("\\Qa.b\\Ecd") == "cd") && 
+                (required_literal("disk \\d\\d failed") == " failed"));
+    }
+    
+    /**
+     * @return true if a file several read buffers long gives the same lines,
+     * numbers and offsets as counting them directly, including a line that 
+     * straddles the end of a buffer and one longer than a buffer.
+     */
+    bool large_search()
+    {
+        const boost::filesystem::path root(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path());
+        boost::filesystem::create_directories(root);
+        
+        std::string data;
+        hit_set expected;
+        std::uintmax_t line(1);
+        for(unsigned int x(0); data.size() < (3 * 1024 * 1024); ++x, ++line)
+        {
+            std::string text((x % 997) ? ("filler line " + std::to_string(x)) : ("needle " + std::to_string(x)));
+            if(x == 50000) text = ("needle " + std::string((2 * 1024 * 1024), 'n'));
+            if(text.compare(0, 6, "needle") == 0) expected.insert(std::make_tuple("big.log", line, data.size(), text));
+            data += (text + '\n');
+        }
+        std::ofstream((root / "big.log").string().c_str(), std::ios::binary)<< data;
+        
+        const hit_set hits(run(root, "needle", true));
+        boost::filesystem::remove_all(root);
+        return (!expected.empty() && (hits == expected));
+    }
+    
+    
+}
+
+#endif
@@ -0,0 +1,14 @@
+#ifdef UNIT_TEST_PROG
+#ifndef SEARCH_TESTS_SEARCH_HPP_INCLUDED
+#define SEARCH_TESTS_SEARCH_HPP_INCLUDED
+
+namespace test
+{
+    bool literal_search();
+    bool regex_search();
+    bool escaped_regex_search();
+    bool large_search();
+}
+
+#endif
+#endif
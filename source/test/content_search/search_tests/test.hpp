@@ -0,0 +1,33 @@
+#ifdef UNIT_TEST_PROG
+#ifndef SEARCH_TESTS_TEST_HPP_INCLUDED
+#define SEARCH_TESTS_TEST_HPP_INCLUDED
+#include <unittest++/UnitTest++.h>
+
+#include "search.hpp"
+
+TEST(content_search_literal_test)
+{
+    bool success(test::literal_search());
+    CHECK(success);
+}
+
+TEST(content_search_regex_test)
+{
+    bool success(test::regex_search());
+    CHECK(success);
+}
+
+TEST(content_search_escape_test)
+{
+    bool success(test::escaped_regex_search());
+    CHECK(success);
+}
+
+TEST(content_search_large_file_test)
+{
+    bool success(test::large_search());
+    CHECK(success);
+}
+
+#endif
+#endif
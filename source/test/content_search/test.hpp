@@ -0,0 +1,8 @@
+#ifdef UNIT_TEST_PROG
+#ifndef CONTENT_SEARCH_TEST_HPP_INCLUDED
+#define CONTENT_SEARCH_TEST_HPP_INCLUDED
+
+#include "test/content_search/search_tests/test.hpp"
+
+#endif
+#endif
@@ -0,0 +1,216 @@
+#ifdef UNIT_TEST_PROG
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "options.hpp"
+#include "filesystem.hpp"
+
+namespace test
+{
+    bool tuned_copy()
+    {
+        using filesystem::copy_iterator;
+        using filesystem::copy_options;
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::remove_all;
+        
+        path root(temp_directory_path() / unique_path());
+        std::string data;
+        for(unsigned int x(0); x < (1024 * 1024 + 17); ++x) data += static_cast<char>(x % 251);
+        create_directories(root / "from");
+        create_directories(root / "to");
+        std::ofstream((root / "from" / "file").string(), std::ios::binary)<< data;
+        
+        copy_options options;
+        options.buffer_size = 64 * 1024;
+        options.drop_cache = true;
+        options.direct_io = true;
+        options.direct_io_threshold = 4096;
+        for(copy_iterator it((root / "from"), (root / "to"), options); !it.end(); ++it);
+        
+        std::ifstream in((root / "to" / "from" / "file").string(), std::ios::binary);
+        std::stringstream copied;
+        copied<< in.rdbuf();
+        in.close();
+        remove_all(root);
+        return (copied.str() == data);
+    }
+    
+    bool hardlink_copy()
+    {
+        using filesystem::copy_iterator;
+        using filesystem::copy_options;
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::create_hard_link;
+        using boost::filesystem::equivalent;
+        using boost::filesystem::remove_all;
+        
+        path root(temp_directory_path() / unique_path());
+        create_directories(root / "from" / "sub");
+        create_directories(root / "to");
+        std::ofstream((root / "from" / "file").string())<< "data";
+        create_hard_link((root / "from" / "file"), (root / "from" / "sub" / "link"));
+        
+        copy_options options;
+        options.preserve_hardlinks = true;
+        options.preserve_sparse = true;
+        for(copy_iterator it((root / "from"), (root / "to"), options); !it.end(); ++it);
+        
+        bool success(equivalent((root / "to" / "from" / "file"), (root / "to" / "from" / "sub" / "link")));
+        remove_all(root);
+        return success;
+    }
+    
+    bool verified_copy()
+    {
+        using filesystem::copy_iterator;
+        using filesystem::copy_options;
+        using filesystem::manifest_entry;
+        using filesystem::read_manifest;
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::remove_all;
+        
+        path root(temp_directory_path() / unique_path());
+        create_directories(root / "from" / "sub");
+        create_directories(root / "to");
+        std::ofstream((root / "from" / "check").string())<< "123456789";
+        std::ofstream((root / "from" / "sub" / "empty").string());
+        
+        copy_options options;
+        options.verify = copy_options::verify_read_back;
+        options.manifest = (root / "manifest");
+        for(copy_iterator it((root / "from"), (root / "to"), options); !it.end(); ++it);
+        
+        std::map<path, manifest_entry> manifest(read_manifest(options.manifest));
+        remove_all(root);
+        
+        //0x995dc9bbdf1939fa is the CRC-64/XZ check value of "123456789":
+        return ((manifest.size() == 2) && (manifest[path("from/check")].digest == 0x995dc9bbdf1939faULL) && 
+                (manifest[path("from/check")].size == 9) && (manifest.count(path("from/sub/empty")) == 1));
+    }
+    
+    /**
+     * @return true if a file copied as several parallel ranges is identical to
+     * the original, and gets the same checksum as a copy made in one stream.
+     */
+    bool parallel_copy()
+    {
+        using filesystem::copy_iterator;
+        using filesystem::copy_options;
+        using filesystem::manifest_entry;
+        using filesystem::read_manifest;
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::remove_all;
+        
+        path root(temp_directory_path() / unique_path());
+        create_directories(root / "from");
+        create_directories(root / "serial");
+        create_directories(root / "parallel");
+        create_directories(root / "unchecked");
+        create_directories(root / "direct");
+        std::string data;
+        for(unsigned int x(0); x < 300007; ++x) data += std::to_string(x * 2654435761u);
+        std::ofstream((root / "from" / "large").string(), std::ios::binary)<< data;
+        
+        copy_options options;
+        options.buffer_size = (64 * 1024);
+        options.parallel_threshold = 0;
+        options.manifest = (root / "serial.manifest");
+        for(copy_iterator it((root / "from"), (root / "serial"), options); !it.end(); ++it);
+        
+        options.parallel_threshold = 1;
+        options.parallel_streams = 4;
+        options.manifest = (root / "parallel.manifest");
+        for(copy_iterator it((root / "from"), (root / "parallel"), options); !it.end(); ++it);
+        
+        //without a checksum, the kernel may move the data itself:
+        options.manifest = path();
+        for(copy_iterator it((root / "from"), (root / "unchecked"), options); !it.end(); ++it);
+        
+        //the tail is not a whole number of blocks, so every stream drops O_DIRECT part way:
+        options.direct_io = true;
+        options.direct_io_threshold = 0;
+        options.manifest = (root / "direct.manifest");
+        for(copy_iterator it((root / "from"), (root / "direct"), options); !it.end(); ++it);
+        
+        std::map<path, manifest_entry> serial(read_manifest(root / "serial.manifest"));
+        std::map<path, manifest_entry> parallel(read_manifest(root / "parallel.manifest"));
+        std::map<path, manifest_entry> direct(read_manifest(root / "direct.manifest"));
+        bool success((serial.size() == 1) && (parallel.size() == 1) && (direct.size() == 1) && 
+                (serial.begin()->second.digest == parallel.begin()->second.digest) && 
+                (serial.begin()->second.digest == direct.begin()->second.digest) && 
+                (parallel.begin()->second.size == data.size()));
+        for(const char* dir : {"parallel", "unchecked", "direct"})
+        {
+            std::ifstream in((root / dir / "from" / "large").string(), std::ios::binary);
+            std::string copied((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            success = (success && (copied == data));
+        }
+        remove_all(root);
+        return success;
+    }
+    
+    /**
+     * @return true if, following links, a directory reached through a link 
+     * as well as its real path is copied in full at both.
+     */
+    bool linked_directory_copy()
+    {
+        using filesystem::copy_iterator;
+        using filesystem::copy_options;
+        using filesystem::traversal_options;
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::create_directory_symlink;
+        using boost::filesystem::is_symlink;
+        using boost::filesystem::remove_all;
+        
+        path root(temp_directory_path() / unique_path());
+        create_directories(root / "from" / "real" / "sub");
+        create_directories(root / "to");
+        std::ofstream((root / "from" / "real" / "sub" / "f.txt").string())<< "data";
+        
+        //one link on either side of the real directory, and one back to the root:
+        create_directory_symlink("real", (root / "from" / "alink"));
+        create_directory_symlink("real", (root / "from" / "link"));
+        create_directory_symlink("..", (root / "from" / "real" / "up"));
+        
+        traversal_options t;
+        t.follow_symlinks = true;
+        for(copy_iterator it((root / "from"), (root / "to"), copy_options(), t); !it.end(); ++it);
+        
+        bool success(true);
+        for(const char* dir : {"alink", "link", "real"})
+        {
+            std::ifstream in((root / "to" / "from" / dir / "sub" / "f.txt").string());
+            std::string copied;
+            in>> copied;
+            success = (success && (copied == "data"));
+        }
+        success = (success && is_symlink(root / "to" / "from" / "real" / "up"));
+        remove_all(root);
+        return success;
+    }
+    
+    
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifdef UNIT_TEST_PROG
+#ifndef OPTION_TESTS_OPTIONS_HPP_INCLUDED
+#define OPTION_TESTS_OPTIONS_HPP_INCLUDED
+
+namespace test
+{
+    bool tuned_copy();
+    bool hardlink_copy();
+    bool verified_copy();
+    bool parallel_copy();
+    bool linked_directory_copy();
+    
+}
+
+#endif
+#endif
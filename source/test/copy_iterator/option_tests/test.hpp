@@ -0,0 +1,39 @@
+#ifdef UNIT_TEST_PROG
+#ifndef OPTION_TESTS_TEST_HPP_INCLUDED
+#define OPTION_TESTS_TEST_HPP_INCLUDED
+#include <unittest++/UnitTest++.h>
+
+#include "options.hpp"
+
+TEST(tuned_copy_test_case)
+{
+    bool success(test::tuned_copy());
+    CHECK(success);
+}
+
+TEST(hardlink_copy_test_case)
+{
+    bool success(test::hardlink_copy());
+    CHECK(success);
+}
+
+TEST(verified_copy_test_case)
+{
+    bool success(test::verified_copy());
+    CHECK(success);
+}
+
+TEST(parallel_copy_test_case)
+{
+    bool success(test::parallel_copy());
+    CHECK(success);
+}
+
+TEST(linked_directory_copy_test_case)
+{
+    bool success(test::linked_directory_copy());
+    CHECK(success);
+}
+
+#endif
+#endif
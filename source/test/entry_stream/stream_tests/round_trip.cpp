@@ -0,0 +1,94 @@
+#ifdef UNIT_TEST_PROG
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "filesystem.hpp"
+#include "entry_stream.hpp"
+#include "round_trip.hpp"
+
+namespace
+{
+    boost::filesystem::path make_tree();
+    
+    
+    /**
+     * @return A new folder with a few hundred entries and a link.
+     */
+    inline boost::filesystem::path make_tree()
+    {
+        using boost::filesystem::path;
+        
+        const path root(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path());
+        for(unsigned int x(0); x < 10; ++x)
+        {
+            const path folder(root / ("folder" + std::to_string(x)) / "nested");
+            boost::filesystem::create_directories(folder);
+            for(unsigned int y(0); y < 30; ++y)
+            {
+                std::ofstream((folder / ("file" + std::to_string(y))).string().c_str())<< "data " << x << ' ' << y;
+            }
+        }
+        boost::filesystem::create_symlink("nested", (root / "folder0" / "link"));
+        return root;
+    }
+    
+    
+}
+
+namespace test
+{
+    /**
+     * @return true if a traversal written with entry_writer reads back with
+     * the same paths and metadata, in the same order.
+     */
+    bool round_trip()
+    {
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::remove;
+        using filesystem::recursive_iterator;
+        using filesystem::entry_writer;
+        using filesystem::entry_reader;
+        using filesystem::file_metadata;
+        
+        const unsigned int fields(file_metadata::type_field | file_metadata::size_field | 
+                file_metadata::mtime_field | file_metadata::inode_field);
+        const boost::filesystem::path root(make_tree());
+        const boost::filesystem::path saved(temp_directory_path() / unique_path());
+        std::vector<std::string> paths;
+        std::vector<file_metadata> meta;
+        bool success(true);
+        
+        {
+            std::ofstream out(saved.string().c_str(), std::ios::binary);
+            entry_writer writer(out, fields);
+            for(recursive_iterator it(root); !it.end(); ++it)
+            {
+                writer.write(it);
+                paths.push_back(it->path().string());
+                meta.push_back(it.metadata(fields));
+            }
+        }
+        
+        std::size_t x(0);
+        for(entry_reader it(saved); (!it.end() && success); ++it, ++x)
+        {
+            const file_metadata& md(it.metadata());
+            success = ((x < paths.size()) && (it->path().string() == paths[x]) && 
+                    (md.valid == (meta[x].valid & fields)) && (md.type == meta[x].type) && 
+                    (md.inode == meta[x].inode) && (md.links == meta[x].links) && (md.rdev == meta[x].rdev) && 
+                    (md.mtime == meta[x].mtime) && 
+                    (!(md.valid & file_metadata::size_field) || (md.size == meta[x].size)));
+        }
+        success = (success && (x == paths.size()));
+        remove(saved);
+        boost::filesystem::remove_all(root);
+        return success;
+    }
+    
+    
+}
+
+#endif
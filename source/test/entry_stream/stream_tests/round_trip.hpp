@@ -0,0 +1,11 @@
+#ifdef UNIT_TEST_PROG
+#ifndef STREAM_TESTS_ROUND_TRIP_HPP_INCLUDED
+#define STREAM_TESTS_ROUND_TRIP_HPP_INCLUDED
+
+namespace test
+{
+    bool round_trip();
+}
+
+#endif
+#endif
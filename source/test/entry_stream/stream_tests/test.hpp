@@ -0,0 +1,15 @@
+#ifdef UNIT_TEST_PROG
+#ifndef STREAM_TESTS_TEST_HPP_INCLUDED
+#define STREAM_TESTS_TEST_HPP_INCLUDED
+#include <unittest++/UnitTest++.h>
+
+#include "round_trip.hpp"
+
+TEST(entry_stream_round_trip_test)
+{
+    bool success(test::round_trip());
+    CHECK(success);
+}
+
+#endif
+#endif
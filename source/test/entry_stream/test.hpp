@@ -0,0 +1,8 @@
+#ifdef UNIT_TEST_PROG
+#ifndef ENTRY_STREAM_TEST_HPP_INCLUDED
+#define ENTRY_STREAM_TEST_HPP_INCLUDED
+
+#include "test/entry_stream/stream_tests/test.hpp"
+
+#endif
+#endif
@@ -0,0 +1,27 @@
+#ifdef UNIT_TEST_PROG
+#ifndef LIMIT_TESTS_TEST_HPP_INCLUDED
+#define LIMIT_TESTS_TEST_HPP_INCLUDED
+#include <unittest++/UnitTest++.h>
+
+#include "throttle.hpp"
+
+TEST(io_scheduler_rate_test)
+{
+    bool success(test::throttle());
+    CHECK(success);
+}
+
+TEST(io_scheduler_backoff_test)
+{
+    bool success(test::backoff());
+    CHECK(success);
+}
+
+TEST(io_scheduler_priority_restore_test)
+{
+    bool success(test::restored_priority());
+    CHECK(success);
+}
+
+#endif
+#endif
@@ -0,0 +1,135 @@
+#ifdef UNIT_TEST_PROG
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <memory>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "filesystem.hpp"
+#include "io_scheduler.hpp"
+#include "throttle.hpp"
+
+namespace
+{
+    long thread_priority();
+    
+    
+    /**
+     * @return The calling thread's I/O priority.
+     */
+    inline long thread_priority()
+    {
+#ifdef SYS_ioprio_get
+        return syscall(SYS_ioprio_get, 1, 0);
+#else
+        return 0;
+#endif
+    }
+    
+    
+}
+
+namespace test
+{
+    /**
+     * @return true if, once the first second's burst is spent, bytes and
+     * operations are handed out no faster than their limits.
+     */
+    bool throttle()
+    {
+        using filesystem::io_limits;
+        using filesystem::io_scheduler;
+        using std::chrono::steady_clock;
+        using std::chrono::milliseconds;
+        
+        io_limits limits;
+        limits.bytes_per_second = (1024 * 1024);
+        limits.ops_per_second = 100;
+        io_scheduler scheduler(limits);
+        
+        //the burst is free:
+        steady_clock::time_point started(steady_clock::now());
+        scheduler.acquire_bytes(1024 * 1024);
+        bool success((steady_clock::now() - started) < milliseconds(100));
+        
+        started = steady_clock::now();
+        scheduler.acquire_bytes(256 * 1024);
+        success = (success && ((steady_clock::now() - started) >= milliseconds(200)));
+        
+        //the operations bucket has had time to refill; empty it again:
+        started = steady_clock::now();
+        scheduler.acquire_ops(100);
+        success = (success && ((steady_clock::now() - started) < milliseconds(100)));
+        
+        started = steady_clock::now();
+        for(unsigned int x(0); x < 20; ++x) scheduler.acquire_ops();
+        return (success && ((steady_clock::now() - started) >= milliseconds(150)));
+    }
+    
+    /**
+     * @return true if slow operations make the scheduler add a delay, and fast
+     * ones take it away again.
+     */
+    bool backoff()
+    {
+        using filesystem::io_limits;
+        using filesystem::io_scheduler;
+        using std::chrono::steady_clock;
+        using std::chrono::milliseconds;
+        
+        io_limits limits;
+        limits.latency_target = milliseconds(5);
+        io_scheduler scheduler(limits);
+        
+        for(unsigned int x(0); x < 8; ++x) scheduler.report(milliseconds(50));
+        steady_clock::time_point started(steady_clock::now());
+        scheduler.acquire_ops();
+        bool success((steady_clock::now() - started) >= milliseconds(10));
+        
+        for(unsigned int x(0); x < 64; ++x) scheduler.report(milliseconds(0));
+        started = steady_clock::now();
+        scheduler.acquire_ops();
+        return (success && ((steady_clock::now() - started) < milliseconds(10)));
+    }
+    
+    /**
+     * @return true if a walk with an idle priority scheduler runs its I/O
+     * at that priority, and leaves the caller's thread as it found it.
+     */
+    bool restored_priority()
+    {
+        using filesystem::io_limits;
+        using filesystem::io_scheduler;
+        using filesystem::io_priority_scope;
+        using filesystem::recursive_iterator;
+        using filesystem::traversal_options;
+        
+        io_limits limits;
+        limits.priority = io_limits::idle_priority;
+        traversal_options options;
+        options.scheduler = std::make_shared<io_scheduler>(limits);
+        
+        const long before(thread_priority());
+        bool success(true);
+        {
+            const io_priority_scope priority(options.scheduler);
+            success = ((thread_priority() == (3 << 13)) || (thread_priority() == before));
+        }
+        success = (success && (thread_priority() == before));
+        
+        const boost::filesystem::path root(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path());
+        boost::filesystem::create_directories(root / "a" / "b");
+        for(recursive_iterator it(root, options); !it.end(); ++it)
+        {
+            //held for the whole walk, not just around each call:
+            it.metadata(filesystem::file_metadata::size_field);
+            success = (success && ((thread_priority() == (3 << 13)) || (thread_priority() == before)));
+        }
+        boost::filesystem::remove_all(root);
+        return (success && (thread_priority() == before));
+    }
+    
+    
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifdef UNIT_TEST_PROG
+#ifndef LIMIT_TESTS_THROTTLE_HPP_INCLUDED
+#define LIMIT_TESTS_THROTTLE_HPP_INCLUDED
+
+namespace test
+{
+    bool throttle();
+    bool backoff();
+    bool restored_priority();
+}
+
+#endif
+#endif
@@ -0,0 +1,8 @@
+#ifdef UNIT_TEST_PROG
+#ifndef IO_SCHEDULER_TEST_HPP_INCLUDED
+#define IO_SCHEDULER_TEST_HPP_INCLUDED
+
+#include "test/io_scheduler/limit_tests/test.hpp"
+
+#endif
+#endif
@@ -0,0 +1,116 @@
+#ifdef UNIT_TEST_PROG
+#include <boost/regex.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "name_filter.hpp"
+#include "kernel.hpp"
+
+namespace
+{
+    std::vector<std::string> make_names();
+    
+    
+    /**
+     * @return Paths made of a few pieces the test patterns look for, so that
+     * many of them match.  Some have newlines, around which '^' and '$' match
+     * too.
+     */
+    inline std::vector<std::string> make_names()
+    {
+        const std::vector<std::string> pieces{"/", "home", "src", ".", "log", "cpp", "hpp", "a", "*", 
+                "build", "_", "x", "2016", "filesystem", "/tmp/", "\n"};
+        std::mt19937 generator(2016);
+        std::uniform_int_distribution<std::size_t> piece(0, (pieces.size() - 1)), count(0, 12);
+        
+        std::vector<std::string> names{"", "/", "a.log", ".log", "log", "/home/src/filesystem.cpp", 
+                "x\n/home/a.cpp\ny", "a.log\nx", "/home/src/filesystem.cpp\n"};
+        for(unsigned int x(0); x < 3000; ++x)
+        {
+            std::string name;
+            for(std::size_t y(count(generator)); y > 0; --y) name += pieces[piece(generator)];
+            names.push_back(name);
+        }
+        return names;
+    }
+    
+    
+}
+
+namespace test
+{
+    /**
+     * @return true if, at every vector level, the filter passes every name the
+     * regex matches, and testing names in batches gives the same answers as
+     * testing them one at a time.
+     */
+    bool filter_agreement()
+    {
+        using filesystem::name_filter;
+        
+        const std::vector<std::string> patterns{".*\\.log", "log", "^/home/.*cpp$", "/tmp/.*_x\\.cpp", 
+                "\\(src\\)*filesystem", "a*b*\\.log$", "^/home/src/filesystem\\.cpp$", "build\\{2\\}x", 
+                "[a-z]*2016[[:digit:]]", "\\*.*", "^\\.log", "2016.*filesystemfilesystem.*$"};
+        const std::vector<filesystem::simd_level> levels{filesystem::scalar_simd, filesystem::sse2_simd, 
+                filesystem::avx2_simd};
+        const std::vector<std::string> names(make_names());
+        
+        bool success(true);
+        for(const std::string& pattern : patterns)
+        {
+            const boost::regex expression(pattern, boost::regex::basic);
+            for(const bool exact : {false, true})
+            {
+                for(const filesystem::simd_level& level : levels)
+                {
+                    if(level > filesystem::simd_support()) continue;
+                    const name_filter filter(pattern, exact, level);
+                    for(std::size_t x(0); x < names.size(); x += 64)
+                    {
+                        std::vector<const char*> batch;
+                        std::vector<std::size_t> lengths;
+                        for(std::size_t y(x); (y < names.size()) && (y < (x + 64)); ++y)
+                        {
+                            batch.push_back(names[y].data());
+                            lengths.push_back(names[y].size());
+                        }
+                        const std::uint64_t passed(filter.passes(batch.data(), lengths.data(), batch.size()));
+                        for(std::size_t y(0); y < batch.size(); ++y)
+                        {
+                            const std::string& name(names[x + y]);
+                            const bool matched(exact ? boost::regex_match(name, expression) : 
+                                    boost::regex_search(name, expression));
+                            const bool single(filter.passes(name));
+                            success = (success && (single == ((passed >> y) & 1)) && (!matched || single));
+                        }
+                    }
+                }
+            }
+        }
+        return success;
+    }
+    
+    /**
+     * @return true if the filter rules out names that can not match.
+     */
+    bool filter_rejection()
+    {
+        using filesystem::name_filter;
+        
+        const name_filter logs(".*\\.log", true);
+        const name_filter source("/tmp/.*_x\\.cpp", false);
+        const name_filter anything("", false);
+        const name_filter alternatives("a\\|b", false);
+        
+        return (logs.passes("/var/a.log") && !logs.passes("/var/a.log.1") && !logs.passes("/var/a.txt") && 
+                source.passes("/tmp/a_x.cpp") && !source.passes("/tmp/a.cpp") && !source.passes("/var/a_x.cpp") && 
+                anything.accepts_all() && alternatives.accepts_all() && !logs.accepts_all());
+    }
+    
+    
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifdef UNIT_TEST_PROG
+#ifndef KERNEL_TESTS_KERNEL_HPP_INCLUDED
+#define KERNEL_TESTS_KERNEL_HPP_INCLUDED
+
+namespace test
+{
+    bool filter_agreement();
+    bool filter_rejection();
+}
+
+#endif
+#endif
@@ -0,0 +1,21 @@
+#ifdef UNIT_TEST_PROG
+#ifndef KERNEL_TESTS_TEST_HPP_INCLUDED
+#define KERNEL_TESTS_TEST_HPP_INCLUDED
+#include <unittest++/UnitTest++.h>
+
+#include "kernel.hpp"
+
+TEST(name_filter_agreement_test)
+{
+    bool success(test::filter_agreement());
+    CHECK(success);
+}
+
+TEST(name_filter_rejection_test)
+{
+    bool success(test::filter_rejection());
+    CHECK(success);
+}
+
+#endif
+#endif
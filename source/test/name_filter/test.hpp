@@ -0,0 +1,8 @@
+#ifdef UNIT_TEST_PROG
+#ifndef NAME_FILTER_TEST_HPP_INCLUDED
+#define NAME_FILTER_TEST_HPP_INCLUDED
+
+#include "test/name_filter/kernel_tests/test.hpp"
+
+#endif
+#endif
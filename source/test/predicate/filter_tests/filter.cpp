@@ -0,0 +1,49 @@
+#ifdef UNIT_TEST_PROG
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <set>
+#include <string>
+
+#include "filesystem.hpp"
+#include "filter.hpp"
+
+namespace test
+{
+    /**
+     * @return true if a size/type/name filter visits exactly the expected files.
+     */
+    bool filter()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::remove_all;
+        using filesystem::recursive_iterator;
+        using filesystem::traversal_options;
+        using filesystem::predicate;
+        
+        path root(temp_directory_path() / unique_path());
+        create_directories(root / "big_dir" / "sub");
+        std::ofstream((root / "small.txt").string())<< "1";
+        std::ofstream((root / "big_dir" / "big.txt").string())<< std::string(4096, 'x');
+        std::ofstream((root / "big_dir" / "sub" / "big.log").string())<< std::string(4096, 'x');
+        
+        traversal_options options;
+        options.filter = (predicate::of_type(boost::filesystem::regular_file) && 
+                predicate::size_between(1024) && predicate::named("\\.txt$"));
+        
+        std::set<path> found;
+        for(recursive_iterator it(root, options); !it.end(); ++it)
+        {
+            found.insert(it->path());
+            if(it.metadata(filesystem::file_metadata::size_field).size != 4096) found.clear();
+        }
+        remove_all(root);
+        return ((found.size() == 1) && (found.count(root / "big_dir" / "big.txt") == 1));
+    }
+    
+    
+}
+
+#endif
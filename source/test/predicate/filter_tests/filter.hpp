@@ -0,0 +1,11 @@
+#ifdef UNIT_TEST_PROG
+#ifndef FILTER_TESTS_FILTER_HPP_INCLUDED
+#define FILTER_TESTS_FILTER_HPP_INCLUDED
+
+namespace test
+{
+    bool filter();
+}
+
+#endif
+#endif
@@ -0,0 +1,15 @@
+#ifdef UNIT_TEST_PROG
+#ifndef FILTER_TESTS_TEST_HPP_INCLUDED
+#define FILTER_TESTS_TEST_HPP_INCLUDED
+#include <unittest++/UnitTest++.h>
+
+#include "filter.hpp"
+
+TEST(predicate_filter_test)
+{
+    bool success(test::filter());
+    CHECK(success);
+}
+
+#endif
+#endif
@@ -0,0 +1,8 @@
+#ifdef UNIT_TEST_PROG
+#ifndef PREDICATE_TEST_HPP_INCLUDED
+#define PREDICATE_TEST_HPP_INCLUDED
+
+#include "test/predicate/filter_tests/test.hpp"
+
+#endif
+#endif
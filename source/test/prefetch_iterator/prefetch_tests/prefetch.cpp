@@ -0,0 +1,111 @@
+#ifdef UNIT_TEST_PROG
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filesystem.hpp"
+#include "prefetch.hpp"
+
+namespace
+{
+    boost::filesystem::path make_tree();
+    
+    
+    /**
+     * @return A new folder with a few hundred entries.
+     */
+    inline boost::filesystem::path make_tree()
+    {
+        using boost::filesystem::path;
+        
+        const path root(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path());
+        for(unsigned int x(0); x < 10; ++x)
+        {
+            const path folder(root / ("folder" + std::to_string(x)) / "nested");
+            boost::filesystem::create_directories(folder);
+            for(unsigned int y(0); y < 30; ++y)
+            {
+                std::ofstream((folder / ("file" + std::to_string(y))).string().c_str())<< "data " << x << ' ' << y;
+            }
+        }
+        return root;
+    }
+    
+    
+}
+
+namespace test
+{
+    /**
+     * @return true if the prefetch_iterator yields exactly what the
+     * recursive_iterator does, in the same order.
+     */
+    bool prefetch()
+    {
+        using filesystem::recursive_iterator;
+        using filesystem::prefetch_iterator;
+        using filesystem::traversal_options;
+        
+        const boost::filesystem::path root(make_tree());
+        std::vector<std::string> expected, prefetched;
+        for(recursive_iterator it(root); !it.end(); ++it)
+        {
+            expected.push_back(it->path().string());
+        }
+        
+        //a tiny ring makes the two threads wait on each other constantly:
+        for(prefetch_iterator it(root, traversal_options(), 4); !it.end(); ++it)
+        {
+            prefetched.push_back(it->path().string());
+        }
+        boost::filesystem::remove_all(root);
+        return (expected == prefetched);
+    }
+    
+    /**
+     * @return true if pruning, levels and metadata come out of a
+     * prefetch_iterator as they do out of a recursive_iterator, even with the
+     * background thread far ahead.
+     */
+    bool pruned_prefetch()
+    {
+        using filesystem::recursive_iterator;
+        using filesystem::prefetch_iterator;
+        using filesystem::traversal_options;
+        using filesystem::file_metadata;
+        
+        //every other folder is pruned:
+        auto prune = [](const boost::filesystem::path& p)
+        {
+            const std::string name(p.filename().string());
+            return ((name.find("folder") == 0) && (((name.back() - '0') % 2) == 1));
+        };
+        
+        const boost::filesystem::path root(make_tree());
+        std::vector<std::string> expected, prefetched;
+        for(recursive_iterator it(root); !it.end(); ++it)
+        {
+            expected.push_back(it->path().string() + " " + std::to_string(it.level()) + " " + 
+                    std::to_string(it.metadata(file_metadata::inode_field).inode));
+            if(prune(it->path())) it.no_push();
+        }
+        
+        for(prefetch_iterator it(root, traversal_options(), 64, file_metadata::type_field); !it.end(); ++it)
+        {
+            //let the background thread get ahead:
+            if(it.level() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            prefetched.push_back(it->path().string() + " " + std::to_string(it.level()) + " " + 
+                    std::to_string(it.metadata(file_metadata::inode_field).inode));
+            if(prune(it->path())) it.no_push();
+        }
+        boost::filesystem::remove_all(root);
+        return ((expected == prefetched) && (expected.size() == 165));
+    }
+    
+    
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifdef UNIT_TEST_PROG
+#ifndef PREFETCH_TESTS_PREFETCH_HPP_INCLUDED
+#define PREFETCH_TESTS_PREFETCH_HPP_INCLUDED
+
+namespace test
+{
+    bool prefetch();
+    bool pruned_prefetch();
+}
+
+#endif
+#endif
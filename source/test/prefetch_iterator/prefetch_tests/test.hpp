@@ -0,0 +1,21 @@
+#ifdef UNIT_TEST_PROG
+#ifndef PREFETCH_TESTS_TEST_HPP_INCLUDED
+#define PREFETCH_TESTS_TEST_HPP_INCLUDED
+#include <unittest++/UnitTest++.h>
+
+#include "prefetch.hpp"
+
+TEST(prefetch_iterator_order_test)
+{
+    bool success(test::prefetch());
+    CHECK(success);
+}
+
+TEST(prefetch_iterator_pruning_test)
+{
+    bool success(test::pruned_prefetch());
+    CHECK(success);
+}
+
+#endif
+#endif
@@ -0,0 +1,8 @@
+#ifdef UNIT_TEST_PROG
+#ifndef PREFETCH_ITERATOR_TEST_HPP_INCLUDED
+#define PREFETCH_ITERATOR_TEST_HPP_INCLUDED
+
+#include "test/prefetch_iterator/prefetch_tests/test.hpp"
+
+#endif
+#endif
@@ -1,8 +1,14 @@
 #ifdef UNIT_TEST_PROG
 #include <boost/filesystem.hpp>
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "filesystem.hpp"
+#include "remove_tree.hpp"
 #include "recursion.hpp"
 
 namespace
@@ -43,6 +49,223 @@ namespace test
         }
     }
     
+    bool bounded_recursion()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::remove_all;
+        using filesystem::recursive_iterator;
+        using filesystem::directory_walker;
+        using filesystem::traversal_options;
+        
+        path root(temp_directory_path() / unique_path()), p(root);
+        for(unsigned int x(0); x < 32; ++x)
+        {
+            p /= std::to_string(x);
+            create_directories(p);
+            std::ofstream((p / "file").string());
+        }
+        
+        traversal_options options;
+        options.max_open_fds = 2;
+        
+        std::size_t unbounded_count(0), bounded_count(0);
+        bool success(true);
+        for(recursive_iterator it(root); !it.end(); ++it) ++unbounded_count;
+        for(directory_walker it(root, options); it != directory_walker(); ++it)
+        {
+            ++bounded_count;
+            if(it.open_handles() > options.max_open_fds) success = false;
+        }
+        remove_all(root);
+        return (success && (unbounded_count == 64) && (bounded_count == unbounded_count));
+    }
+    
+    bool pruned_recursion()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::remove_all;
+        using filesystem::recursive_iterator;
+        using filesystem::traversal_options;
+        
+        path root(temp_directory_path() / unique_path());
+        create_directories(root / "src" / "deep" / "deeper");
+        create_directories(root / ".git" / "objects");
+        create_directories(root / "build" / "out");
+        
+        traversal_options options;
+        options.excluded_names.insert(".git");
+        options.excluded_paths.insert((root / "build").string());
+        options.max_depth = 1;
+        options.same_filesystem = true;
+        
+        std::size_t count(0);
+        bool success(true);
+        for(recursive_iterator it(root, options); !it.end(); ++it)
+        {
+            ++count;
+            if(it->path().string().find(".git") != std::string::npos) success = false;
+            if(it->path().string().find("build") != std::string::npos) success = false;
+        }
+        remove_all(root);
+        
+        //only "src" and "src/deep" are left:
+        return (success && (count == 2));
+    }
+    
+    /**
+     * @return true if following symbolic links reads each real directory
+     * once, however many links lead to it, and stops at cycles.
+     */
+    bool followed_recursion()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::create_directory_symlink;
+        using boost::filesystem::remove_all;
+        using filesystem::recursive_iterator;
+        using filesystem::traversal_options;
+        
+        path root(temp_directory_path() / unique_path());
+        create_directories(root / "real" / "sub");
+        std::ofstream((root / "real" / "sub" / "file").string().c_str());
+        create_directories(root / "farm");
+        create_directory_symlink((root / "real"), (root / "farm" / "first"));
+        create_directory_symlink((root / "real"), (root / "farm" / "second"));
+        create_directory_symlink((root / "real"), (root / "real" / "sub" / "loop"));
+        
+        traversal_options options;
+        options.follow_symlinks = true;
+        
+        //"file" is only reached once, through whichever link comes first:
+        std::size_t files(0), count(0);
+        for(recursive_iterator it((root / "farm"), options); !it.end(); ++it, ++count)
+        {
+            if(it->path().filename() == "file") ++files;
+        }
+        remove_all(root);
+        
+        //first, second, and one each of sub, file and loop:
+        return ((files == 1) && (count == 5));
+    }
+    
+    /**
+     * @return true if, with an fd cap, a directory closed while deeper ones
+     * were read is picked up where it left off, even after the entry it
+     * stopped at is deleted, and the walk fails rather than follow a link
+     * that replaced it.
+     */
+    bool reopened_recursion()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::create_directory_symlink;
+        using boost::filesystem::rename;
+        using boost::filesystem::remove_all;
+        using boost::filesystem::filesystem_error;
+        using filesystem::recursive_iterator;
+        using filesystem::traversal_options;
+        
+        const path root(temp_directory_path() / unique_path());
+        create_directories(root / "a" / "sub" / "x" / "y");
+        create_directories(root / "elsewhere" / "sub" / "x" / "y");
+        std::ofstream((root / "a" / "sub" / "x" / "y" / "leaf").string());
+        for(unsigned int x(0); x < 50; ++x)
+        {
+            std::ofstream((root / "a" / ("file" + std::to_string(x))).string());
+            std::ofstream((root / "elsewhere" / ("other" + std::to_string(x))).string());
+        }
+        
+        traversal_options options;
+        options.max_open_fds = 2;
+        
+        //the entry "a" stopped at disappears while "a" is closed:
+        std::size_t files(0);
+        for(recursive_iterator it((root / "a"), options); !it.end(); ++it)
+        {
+            if(it->path().filename() == "leaf") remove_all(root / "a" / "sub");
+            if(it->path().filename().string().find("file") == 0) ++files;
+        }
+        bool success(files == 50);
+        
+        //"a" is swapped for a link while it is closed:
+        create_directories(root / "a" / "sub" / "x" / "y");
+        std::ofstream((root / "a" / "sub" / "x" / "y" / "leaf").string());
+        bool failed(false);
+        try
+        {
+            for(recursive_iterator it(root, options); !it.end(); ++it)
+            {
+                if(it->path() == (root / "a" / "sub" / "x" / "y" / "leaf"))
+                {
+                    rename((root / "a"), (root / "moved"));
+                    create_directory_symlink((root / "elsewhere"), (root / "a"));
+                }
+                if(it->path().filename().string().find("other") == 0)
+                {
+                    success = (success && (it->path().parent_path() == (root / "elsewhere")));
+                }
+            }
+        }
+        catch(const filesystem_error&)
+        {
+            failed = true;
+        }
+        remove_all(root);
+        return (success && failed);
+    }
+    
+    /**
+     * @return true if, with one handle allowed, a tree whose paths are longer
+     * than PATH_MAX is walked to the bottom.  Directories whose parent was
+     * closed must be opened relative to it, not by their whole path.
+     */
+    bool deep_recursion()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using filesystem::recursive_iterator;
+        using filesystem::traversal_options;
+        
+        //made a level at a time; the whole path is too long to use:
+        const path root(temp_directory_path() / unique_path());
+        const std::string name(200, 'd');
+        const unsigned int depth(40);
+        boost::filesystem::create_directories(root);
+        int fd(::open(root.c_str(), (O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+        for(unsigned int x(0); ((x < depth) && (fd != -1)); ++x)
+        {
+            mkdirat(fd, name.c_str(), 0755);
+            const int next(openat(fd, name.c_str(), (O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+            ::close(fd);
+            fd = next;
+        }
+        if(fd != -1) ::close(fd);
+        
+        traversal_options options;
+        options.max_open_fds = 1;
+        
+        unsigned int count(0);
+        bool success(true);
+        for(recursive_iterator it(root, options); !it.end(); ++it)
+        {
+            ++count;
+            success = (success && (static_cast<unsigned int>(it.level()) < depth));
+        }
+        filesystem::remove_tree(root);
+        return (success && (count == depth) && !boost::filesystem::exists(root));
+    }
+    
     
 }
 
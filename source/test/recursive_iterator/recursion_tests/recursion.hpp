@@ -5,6 +5,11 @@
 namespace test
 {
     void recursion();
+    bool bounded_recursion();
+    bool pruned_recursion();
+    bool followed_recursion();
+    bool reopened_recursion();
+    bool deep_recursion();
 }
 
 #endif
@@ -9,5 +9,35 @@ TEST(recursive_iterator_recursion_test)
     test::recursion();
 }
 
+TEST(recursive_iterator_bounded_fd_test)
+{
+    bool success(test::bounded_recursion());
+    CHECK(success);
+}
+
+TEST(recursive_iterator_pruning_test)
+{
+    bool success(test::pruned_recursion());
+    CHECK(success);
+}
+
+TEST(recursive_iterator_follow_symlinks_test)
+{
+    bool success(test::followed_recursion());
+    CHECK(success);
+}
+
+TEST(recursive_iterator_reopen_test)
+{
+    bool success(test::reopened_recursion());
+    CHECK(success);
+}
+
+TEST(recursive_iterator_deep_test)
+{
+    bool success(test::deep_recursion());
+    CHECK(success);
+}
+
 #endif
 #endif
@@ -0,0 +1,107 @@
+#ifdef UNIT_TEST_PROG
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "remove_tree.hpp"
+#include "removal.hpp"
+
+namespace test
+{
+    /**
+     * @return true if a dry run lists everything but deletes nothing, and a
+     * real run then deletes everything except the excluded directory and the
+     * directories above it.
+     */
+    bool removal()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::exists;
+        using boost::filesystem::remove_all;
+        using filesystem::remove_options;
+        using filesystem::remove_result;
+        using filesystem::remove_tree;
+        
+        const path root(temp_directory_path() / unique_path());
+        std::uintmax_t count(1);
+        for(unsigned int x(0); x < 8; ++x)
+        {
+            const path dir(root / std::to_string(x) / "nested");
+            create_directories(dir);
+            count += 2;
+            for(unsigned int y(0); y < 16; ++y, ++count)
+            {
+                std::ofstream out((dir / std::to_string(y)).string().c_str());
+                out<< y;
+            }
+        }
+        create_directories(root / "3" / "keep");
+        std::ofstream((root / "3" / "keep" / "file").string().c_str())<< "kept";
+        
+        remove_options options;
+        options.threads = 4;
+        options.dry_run = true;
+        remove_result result(remove_tree(root, options));
+        bool success(result.errors.empty() && (result.removed == (count + 2)) && 
+                (result.listed.size() == result.removed) && (result.listed.back() == root) && 
+                exists(root / "0" / "nested" / "0"));
+        
+        options.dry_run = false;
+        options.traversal.excluded_names.insert("keep");
+        if(success)
+        {
+            result = remove_tree(root, options);
+            success = (result.errors.empty() && (result.removed == (count - 2)) && 
+                    exists(root / "3" / "keep" / "file") && !exists(root / "3" / "nested") && 
+                    !exists(root / "0"));
+        }
+        remove_all(root);
+        return success;
+    }
+    
+    /**
+     * @return true if a filter that throws on one of the worker threads stops
+     * the removal, and the exception reaches the caller.
+     */
+    bool failed_removal()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::remove_all;
+        using filesystem::remove_options;
+        using filesystem::remove_tree;
+        using filesystem::predicate;
+        
+        const path root(temp_directory_path() / unique_path());
+        for(unsigned int x(0); x < 8; ++x) create_directories(root / std::to_string(x) / "nested");
+        
+        //too ambiguous for boost to finish matching against this name:
+        const std::string name(std::string(60, 'a') + "b" + std::string(60, 'a'));
+        std::ofstream((root / "5" / "nested" / name).string().c_str());
+        
+        remove_options options;
+        options.threads = 4;
+        options.traversal.filter = predicate::named("\\(a*\\)*b$", true);
+        bool thrown(false);
+        try
+        {
+            remove_tree(root, options);
+        }
+        catch(const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        remove_all(root);
+        return thrown;
+    }
+    
+    
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifdef UNIT_TEST_PROG
+#ifndef REMOVE_TESTS_REMOVAL_HPP_INCLUDED
+#define REMOVE_TESTS_REMOVAL_HPP_INCLUDED
+
+namespace test
+{
+    bool removal();
+    bool failed_removal();
+}
+
+#endif
+#endif
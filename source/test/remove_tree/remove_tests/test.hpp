@@ -0,0 +1,21 @@
+#ifdef UNIT_TEST_PROG
+#ifndef REMOVE_TESTS_TEST_HPP_INCLUDED
+#define REMOVE_TESTS_TEST_HPP_INCLUDED
+#include <unittest++/UnitTest++.h>
+
+#include "removal.hpp"
+
+TEST(remove_tree_test)
+{
+    bool success(test::removal());
+    CHECK(success);
+}
+
+TEST(remove_tree_failure_test)
+{
+    bool success(test::failed_removal());
+    CHECK(success);
+}
+
+#endif
+#endif
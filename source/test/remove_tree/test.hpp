@@ -0,0 +1,8 @@
+#ifdef UNIT_TEST_PROG
+#ifndef REMOVE_TREE_TEST_HPP_INCLUDED
+#define REMOVE_TREE_TEST_HPP_INCLUDED
+
+#include "test/remove_tree/remove_tests/test.hpp"
+
+#endif
+#endif
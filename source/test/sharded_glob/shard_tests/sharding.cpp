@@ -0,0 +1,60 @@
+#ifdef UNIT_TEST_PROG
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <set>
+#include <string>
+
+#include "filesystem.hpp"
+#include "shard.hpp"
+#include "sharding.hpp"
+
+namespace test
+{
+    /**
+     * @return true if a sharded_glob finds the same entries as a recursive_glob.
+     */
+    bool sharded()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::remove_all;
+        using filesystem::recursive_glob;
+        using filesystem::sharded_glob;
+        using filesystem::shard_options;
+        
+        //wide and deep enough that the workers have directories to hand around:
+        const path root(temp_directory_path() / unique_path());
+        for(unsigned int x(0); x < 6; ++x)
+        {
+            for(unsigned int y(0); y < 6; ++y)
+            {
+                const path folder(root / ("d" + std::to_string(x)) / ("e" + std::to_string(y)) / "f");
+                create_directories(folder);
+                for(const char* name : {"a.cpp", "b.hpp", "c.txt"}) std::ofstream((folder / name).string());
+                std::ofstream((folder.parent_path() / "g.cpp").string());
+            }
+        }
+        
+        std::set<path> expected, found;
+        for(recursive_glob it(root, "[ch]pp$"); !it.end(); ++it)
+        {
+            expected.insert(it->path());
+        }
+        
+        shard_options options;
+        options.workers = 3;
+        options.expression = "[ch]pp$";
+        for(sharded_glob it(root, options); !it.end(); ++it)
+        {
+            found.insert(it->path());
+        }
+        remove_all(root);
+        return ((expected.size() == (6 * 6 * 3)) && (expected == found));
+    }
+    
+    
+}
+
+#endif
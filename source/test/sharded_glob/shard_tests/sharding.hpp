@@ -0,0 +1,11 @@
+#ifdef UNIT_TEST_PROG
+#ifndef SHARD_TESTS_SHARDING_HPP_INCLUDED
+#define SHARD_TESTS_SHARDING_HPP_INCLUDED
+
+namespace test
+{
+    bool sharded();
+}
+
+#endif
+#endif
@@ -0,0 +1,15 @@
+#ifdef UNIT_TEST_PROG
+#ifndef SHARD_TESTS_TEST_HPP_INCLUDED
+#define SHARD_TESTS_TEST_HPP_INCLUDED
+#include <unittest++/UnitTest++.h>
+
+#include "sharding.hpp"
+
+TEST(sharded_glob_test)
+{
+    bool success(test::sharded());
+    CHECK(success);
+}
+
+#endif
+#endif
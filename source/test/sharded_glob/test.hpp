@@ -0,0 +1,8 @@
+#ifdef UNIT_TEST_PROG
+#ifndef SHARDED_GLOB_TEST_HPP_INCLUDED
+#define SHARDED_GLOB_TEST_HPP_INCLUDED
+
+#include "test/sharded_glob/shard_tests/test.hpp"
+
+#endif
+#endif
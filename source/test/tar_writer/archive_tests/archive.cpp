@@ -0,0 +1,200 @@
+#ifdef UNIT_TEST_PROG
+#include <boost/filesystem.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "filesystem.hpp"
+#include "tar_writer.hpp"
+#include "archive.hpp"
+
+namespace test
+{
+    /**
+     * @return true if every file and directory of a tree is in the archive
+     * it was written to, under its relative name, with its contents intact.
+     */
+    bool archive()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using boost::filesystem::create_directories;
+        using boost::filesystem::remove_all;
+        using filesystem::recursive_iterator;
+        using filesystem::tar_writer;
+        
+        const path root(temp_directory_path() / unique_path());
+        const path saved(temp_directory_path() / unique_path());
+        std::map<std::string, std::string> expected;
+        for(unsigned int x(0); x < 4; ++x)
+        {
+            const std::string dir("dir" + std::to_string(x));
+            create_directories(root / dir);
+            expected[dir + "/"] = std::string();
+            for(unsigned int y(0); y < 4; ++y)
+            {
+                const std::string name(dir + "/" + std::to_string(y));
+                const std::string contents(((x * 700) + y), static_cast<char>('a' + y));
+                std::ofstream((root / name).string().c_str(), std::ios::binary)<< contents;
+                expected[name] = contents;
+            }
+        }
+        
+        int fd(::open(saved.c_str(), (O_WRONLY | O_CREAT | O_TRUNC), 0644));
+        bool success(fd != -1);
+        if(success)
+        {
+            tar_writer writer(fd, root);
+            for(recursive_iterator it(root); !it.end(); ++it) writer.write(it);
+            writer.finish();
+            ::close(fd);
+        }
+        
+        //read the headers back:
+        std::ifstream in(saved.string().c_str(), std::ios::binary);
+        std::string archived((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::map<std::string, std::string> found;
+        std::size_t pos(0);
+        while(success && ((pos + 512) <= archived.size()) && (archived[pos] != '\0'))
+        {
+            const std::string name(archived.c_str() + pos);
+            const std::size_t size(std::strtoul(archived.substr((pos + 124), 12).c_str(), nullptr, 8));
+            success = ((archived.compare((pos + 257), 5, "ustar") == 0) && ((pos + 512 + size) <= archived.size()));
+            if(success) found[name] = archived.substr((pos + 512), size);
+            pos += (512 + (((size + 511) / 512) * 512));
+        }
+        success = (success && (found == expected) && ((archived.size() % 10240) == 0));
+        
+        remove_all(root);
+        boost::filesystem::remove(saved);
+        return success;
+    }
+    
+    /**
+     * @return true if a file that could not be archived is not made the
+     * target of a later hard link, and a device is archived with the device
+     * number it was given.
+     */
+    bool archived_links()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using filesystem::file_metadata;
+        using filesystem::tar_writer;
+        
+        const path root(temp_directory_path() / unique_path());
+        const path saved(temp_directory_path() / unique_path());
+        boost::filesystem::create_directories(root);
+        std::ofstream((root / "file").string().c_str(), std::ios::binary)<< "contents";
+        boost::filesystem::create_hard_link((root / "file"), (root / "link"));
+        
+        struct stat st;
+        int fd(::open(saved.c_str(), (O_WRONLY | O_CREAT | O_TRUNC), 0644));
+        bool success((fd != -1) && (lstat((root / "file").c_str(), &st) == 0));
+        if(success)
+        {
+            tar_writer writer(fd, root);
+            file_metadata md;
+            md.assign(st);
+            
+            //the first name has vanished by the time it is opened:
+            try
+            {
+                writer.write((root / "gone"), md);
+                success = false;
+            }
+            catch(const boost::filesystem::filesystem_error&)
+            {
+            }
+            writer.write((root / "link"), md);
+            
+            //a device that is not on disk, so only its metadata can number it:
+            md.type = boost::filesystem::character_file;
+            md.rdev = makedev(12, 34);
+            writer.write((root / "device"), md);
+            writer.finish();
+            ::close(fd);
+        }
+        
+        std::ifstream in(saved.string().c_str(), std::ios::binary);
+        std::string archived((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        success = (success && (archived.size() >= 1536) && 
+                (std::string(archived.c_str()) == "link") && (archived[156] == '0') && 
+                (archived.compare(512, 8, "contents") == 0) && 
+                (std::string(archived.c_str() + 1024) == "device") && (archived[1024 + 156] == '3') && 
+                (std::strtoul(archived.substr((1024 + 329), 8).c_str(), nullptr, 8) == 12) && 
+                (std::strtoul(archived.substr((1024 + 337), 8).c_str(), nullptr, 8) == 34));
+        
+        boost::filesystem::remove_all(root);
+        boost::filesystem::remove(saved);
+        return success;
+    }
+    
+    /**
+     * @return true if an entry whose data can not be read still takes up the
+     * room its header gave it, so the next entry is where it belongs, and a
+     * time before 1970 is kept in a pax record.
+     */
+    bool unreadable_entries()
+    {
+        using boost::filesystem::path;
+        using boost::filesystem::temp_directory_path;
+        using boost::filesystem::unique_path;
+        using filesystem::file_metadata;
+        using filesystem::tar_writer;
+        
+        const path root(temp_directory_path() / unique_path());
+        const path saved(temp_directory_path() / unique_path());
+        boost::filesystem::create_directories(root / "dir");
+        std::ofstream((root / "file").string().c_str(), std::ios::binary)<< "contents";
+        
+        struct stat st;
+        int fd(::open(saved.c_str(), (O_WRONLY | O_CREAT | O_TRUNC), 0644));
+        bool success((fd != -1) && (lstat((root / "file").c_str(), &st) == 0));
+        if(success)
+        {
+            tar_writer writer(fd, root);
+            file_metadata md;
+            md.assign(st);
+            
+            //a directory opens, but can not be read like a file:
+            try
+            {
+                writer.write((root / "dir"), md);
+                success = false;
+            }
+            catch(const boost::filesystem::filesystem_error&)
+            {
+            }
+            md.mtime = -100;
+            writer.write((root / "file"), md);
+            writer.finish();
+            ::close(fd);
+        }
+        
+        //"dir", its block of zeros, then the pax header and its record:
+        std::ifstream in(saved.string().c_str(), std::ios::binary);
+        std::string archived((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        success = (success && (archived.size() >= 2560) && 
+                (std::string(archived.c_str()) == "dir") && 
+                (archived.compare(512, 512, std::string(512, '\0')) == 0) && 
+                (archived[1024 + 156] == 'x') && 
+                (archived.substr(1536, 512).find(" mtime=-100\n") != std::string::npos));
+        
+        boost::filesystem::remove_all(root);
+        boost::filesystem::remove(saved);
+        return success;
+    }
+    
+    
+}
+
+#endif
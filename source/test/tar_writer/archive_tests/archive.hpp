@@ -0,0 +1,13 @@
+#ifdef UNIT_TEST_PROG
+#ifndef ARCHIVE_TESTS_ARCHIVE_HPP_INCLUDED
+#define ARCHIVE_TESTS_ARCHIVE_HPP_INCLUDED
+
+namespace test
+{
+    bool archive();
+    bool archived_links();
+    bool unreadable_entries();
+}
+
+#endif
+#endif
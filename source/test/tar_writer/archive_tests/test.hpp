@@ -0,0 +1,27 @@
+#ifdef UNIT_TEST_PROG
+#ifndef ARCHIVE_TESTS_TEST_HPP_INCLUDED
+#define ARCHIVE_TESTS_TEST_HPP_INCLUDED
+#include <unittest++/UnitTest++.h>
+
+#include "archive.hpp"
+
+TEST(tar_writer_test)
+{
+    bool success(test::archive());
+    CHECK(success);
+}
+
+TEST(tar_writer_link_test)
+{
+    bool success(test::archived_links());
+    CHECK(success);
+}
+
+TEST(tar_writer_unreadable_test)
+{
+    bool success(test::unreadable_entries());
+    CHECK(success);
+}
+
+#endif
+#endif
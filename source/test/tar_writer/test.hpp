@@ -0,0 +1,8 @@
+#ifdef UNIT_TEST_PROG
+#ifndef TAR_WRITER_TEST_HPP_INCLUDED
+#define TAR_WRITER_TEST_HPP_INCLUDED
+
+#include "test/tar_writer/archive_tests/test.hpp"
+
+#endif
+#endif
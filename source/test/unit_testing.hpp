@@ -5,9 +5,19 @@
 
 //tests:
 //#include "test/regular_iterator/test.hpp"
-//#include "test/recursive_iterator/test.hpp"
-//#include "test/copy_iterator/test.hpp"
+#include "test/recursive_iterator/test.hpp"
+#include "test/copy_iterator/test.hpp"
 #include "test/glob_tests/glob_tests.hpp"
+#include "test/prefetch_iterator/test.hpp"
+#include "test/predicate/test.hpp"
+#include "test/sharded_glob/test.hpp"
+#include "test/entry_stream/test.hpp"
+#include "test/remove_tree/test.hpp"
+#include "test/tar_writer/test.hpp"
+#include "test/io_scheduler/test.hpp"
+#include "test/content_search/test.hpp"
+#include "test/name_filter/test.hpp"
+#include "test/async_walk/test.hpp"
 
 namespace
 {